@@ -0,0 +1,96 @@
+#include "frame-pacer.h"
+
+#include <SFML/System.hpp>
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <ctime>
+#include <iostream>
+#include <vector>
+
+// Frame time stability of the old sf::sleep loop versus FramePacer at high
+// refresh rates. Each frame does 1ms of work , the error is how far the
+// real frame time is from 1/fps. CPU time shows the cost of the spin
+
+namespace sfe {
+namespace {
+
+const std::size_t kFrameSize = 240;
+
+typedef std::chrono::steady_clock Clock;
+
+void Work() {
+  auto end = Clock::now() + std::chrono::milliseconds(1);
+  while(Clock::now() < end) ;
+}
+
+void Report( const char* name , std::uint32_t fps ,
+             std::vector<double>* frame , double cpu ) {
+  const double target = 1000000.0 / fps;
+  std::vector<double> error;
+  for( auto e : *frame ) error.push_back(std::fabs(e - target));
+  std::sort(error.begin(),error.end());
+
+  double sum = 0.0;
+  for( auto e : error ) sum += e;
+
+  std::cout << name << " " << fps << "fps , mean error:"
+            << sum / error.size() << "us , p99 error:"
+            << error[error.size() * 99 / 100] << "us , cpu:"
+            << cpu * 100.0 << "%\n";
+}
+
+// The loop App::Start used to have , sleep the rest of the frame and
+// measure from the start of the frame
+void MeasureSleep( std::uint32_t fps ) {
+  std::vector<double> frame;
+  auto cpu   = std::clock();
+  auto start = Clock::now();
+  auto prev  = Clock::now();
+
+  for( std::size_t i = 0 ; i < kFrameSize ; ++i ) {
+    auto begin = Clock::now();
+    Work();
+    auto seconds = std::chrono::duration<float>(Clock::now() - begin).count();
+    auto left    = (1.0f/fps) - seconds;
+    if(left > 0) sf::sleep(sf::seconds(left));
+
+    auto now = Clock::now();
+    frame.push_back(std::chrono::duration<double,std::micro>(now - prev).count());
+    prev = now;
+  }
+
+  auto wall = std::chrono::duration<double>(Clock::now() - start).count();
+  Report("sleep",fps,&frame,
+         static_cast<double>(std::clock() - cpu) / CLOCKS_PER_SEC / wall);
+}
+
+void MeasurePacer( std::uint32_t fps ) {
+  FramePacer pacer(fps);
+  std::vector<double> frame;
+  auto cpu   = std::clock();
+  auto start = Clock::now();
+
+  for( std::size_t i = 0 ; i < kFrameSize ; ++i ) {
+    Work();
+    frame.push_back(pacer.Wait() * 1000000.0);
+  }
+
+  auto wall = std::chrono::duration<double>(Clock::now() - start).count();
+  Report("pacer",fps,&frame,
+         static_cast<double>(std::clock() - cpu) / CLOCKS_PER_SEC / wall);
+  pacer.Dump(&std::cout);
+}
+
+} // namespace
+} // namespace sfe
+
+int main() {
+  using namespace sfe;
+
+  for( std::uint32_t fps : { 60 , 144 , 240 } ) {
+    MeasureSleep(fps);
+    MeasurePacer(fps);
+  }
+  return 0;
+}
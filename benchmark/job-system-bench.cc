@@ -0,0 +1,71 @@
+#include "job-system.h"
+
+#include <chrono>
+#include <cmath>
+#include <iostream>
+#include <vector>
+
+// Scheduling overhead of the JobSystem. An empty job shows the fixed cost
+// per job , then jobs of a few microseconds of work are run serially and
+// through ParallelFor to find where they become profitable
+
+namespace sfe {
+namespace {
+
+const std::size_t kEmptyJobSize = 200000;
+const std::size_t kItemSize     = 20000;
+
+typedef std::chrono::steady_clock Clock;
+
+double Elapsed( Clock::time_point start ) {
+  return std::chrono::duration<double,std::micro>(Clock::now() - start).count();
+}
+
+// about 1us of work per call on a desktop CPU
+float Work( std::size_t i ) {
+  float v = static_cast<float>(i);
+  for( int k = 0 ; k < 200 ; ++k ) v = std::sqrt(v * v + 1.0f);
+  return v;
+}
+
+} // namespace
+} // namespace sfe
+
+int main() {
+  using namespace sfe;
+
+  auto& jobs = JobSystem::GetInstance();
+  std::cout << "workers:" << jobs.worker_count() << "\n";
+
+  {
+    JobCounter counter;
+    auto start = Clock::now();
+    for( std::size_t i = 0 ; i < kEmptyJobSize ; ++i )
+      jobs.Run(&counter,[]() {});
+    jobs.Wait(&counter);
+    std::cout << "empty job: " << Elapsed(start) * 1000.0 / kEmptyJobSize
+              << " ns/job\n";
+  }
+
+  std::vector<float> output(kItemSize);
+  double serial = 0.0;
+  {
+    auto start = Clock::now();
+    for( std::size_t i = 0 ; i < kItemSize ; ++i ) output[i] = Work(i);
+    serial = Elapsed(start);
+    std::cout << "serial: " << serial << " us , "
+              << serial / kItemSize << " us/item\n";
+  }
+
+  // grain is how many items form one job
+  for( std::size_t grain : { 1 , 2 , 4 , 16 , 64 , 256 } ) {
+    auto start = Clock::now();
+    jobs.ParallelFor(0,kItemSize,grain,[&output]( std::size_t b , std::size_t e ) {
+      for( std::size_t i = b ; i < e ; ++i ) output[i] = Work(i);
+    });
+    auto us = Elapsed(start);
+    std::cout << "parallel_for grain:" << grain << " " << us << " us , speedup:"
+              << serial / us << "x\n";
+  }
+  return 0;
+}
@@ -0,0 +1,63 @@
+#include "render-batch.h"
+#include "job-system.h"
+
+#include <chrono>
+#include <iostream>
+#include <memory>
+#include <thread>
+#include <vector>
+
+// Scaling of RenderBatch::EnqueueQuadsParallel split into 1/2/4/8 jobs , every
+// quad moves each frame so all of them need to be transformed
+
+namespace sfe {
+namespace {
+
+const std::size_t kQuadSize  = 200000;
+const std::size_t kFrameSize = 50;
+
+} // namespace
+} // namespace sfe
+
+int main() {
+  using namespace sfe;
+
+  RenderBatch batch(sf::BlendAlpha);
+  batch.set_quad_list(true);
+  batch.Reserve(kQuadSize);
+
+  std::vector<std::unique_ptr<Quad>> quads(kQuadSize);
+  std::vector<const Quad*> list(kQuadSize);
+  for( std::size_t i = 0 ; i < kQuadSize ; ++i ) {
+    quads[i].reset(new Quad(&batch,sf::IntRect(0,0,16,16)));
+    list [i] = quads[i].get();
+  }
+
+  std::cout << "hardware threads:" << std::thread::hardware_concurrency()
+            << " , job workers:" << JobSystem::GetInstance().worker_count() << "\n";
+
+  double base = 0.0;
+  for( std::size_t job : { 1 , 2 , 4 , 8 } ) {
+    std::chrono::duration<double> d(0);
+
+    for( std::size_t f = 0 ; f < kFrameSize ; ++f ) {
+      for( std::size_t i = 0 ; i < kQuadSize ; ++i ) {
+        quads[i]->SetPosition(static_cast<float>(i % 1000),
+                              static_cast<float>(f));
+        quads[i]->SetRotation(static_cast<float>((i + f) % 360));
+      }
+
+      // only measure the vertex generation
+      auto start = std::chrono::steady_clock::now();
+      batch.EnqueueQuadsParallel(list.data(),list.size(),job);
+      d += std::chrono::steady_clock::now() - start;
+      batch.Clear();
+    }
+
+    auto ms = d.count() * 1000.0 / kFrameSize;
+    if(job == 1) base = ms;
+    std::cout << "jobs:" << job << " " << ms << " ms/frame , speedup:"
+              << base / ms << "x\n";
+  }
+  return 0;
+}
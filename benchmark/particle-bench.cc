@@ -0,0 +1,312 @@
+#include "particle-system.h"
+#include "job-system.h"
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <iostream>
+#include <random>
+#include <vector>
+
+// Update cost of 1M particles on a single core. Compares the old array of
+// structure layout against the structure of arrays kernel , scalar and SIMD.
+// Build with SIMD_FLAGS=-mavx for the AVX kernel
+//
+// The pool section runs a sparse emitter with only 5% of the capacity alive ,
+// the living particles scattered over the capacity and marked by age like
+// before , against the dense pool.
+//
+// The render section writes the quads of the living particles into a batch
+// through a Quad , like every particle did with its own Quad and its float
+// color before , and directly from the particle fields and the color and
+// size lut.
+//
+// The parallel section updates and renders a large emitter on the calling
+// thread only and split in chunks on the JobSystem.
+//
+// The kernel section updates the presets of common emitters with the
+// generic kernel and with the kernel of their feature set
+
+namespace sfe {
+namespace {
+
+const std::size_t kParticleSize = 1000000;
+const std::size_t kFrameSize    = 100;
+const float       kDelta        = 1.0f / 60.0f;
+const std::size_t kSparseRatio  = 20;     // 1 of 20 slots alive
+
+// The particle layout before the structure of arrays storage , with the
+// color and size deltas integrated every frame instead of the lut
+struct Particle {
+  float position_x , position_y;
+  float velocity_x , velocity_y;
+  float gravity;
+  float radial_acc;
+  float tangential_acc;
+  float spin , spin_delta;
+  float size , size_delta;
+  float r , g , b , a;
+  float delta_r , delta_g , delta_b , delta_a;
+  float life;
+  float age;
+
+  void Update( float delta , float ox , float oy ) {
+    if(age < 0.0f) return;
+    age += delta;
+    if(age >= life) { age = -1.0f; return; }
+
+    auto dx  = position_x - ox;
+    auto dy  = position_y - oy;
+    auto len = std::sqrt(dx * dx + dy * dy);
+    if(len > 0.0f) { dx /= len; dy /= len; }
+
+    velocity_x += (dx * radial_acc - dy * tangential_acc) * delta;
+    velocity_y += (dy * radial_acc + dx * tangential_acc + gravity) * delta;
+    position_x += velocity_x * delta;
+    position_y += velocity_y * delta;
+    spin += spin_delta * delta;
+    size += size_delta * delta;
+    r += delta_r * delta; g += delta_g * delta;
+    b += delta_b * delta; a += delta_a * delta;
+  }
+};
+
+float* Field( detail::ParticleBuffer* buffer , int f ) {
+  return (*buffer)[static_cast<detail::ParticleBuffer::Field>(f)];
+}
+
+// Every particle lives through the whole benchmark
+void Fill( detail::ParticleBuffer* buffer , std::vector<Particle>* aos ) {
+  typedef detail::ParticleBuffer B;
+  std::mt19937 gen(42);
+  std::uniform_real_distribution<float> value(-100.0f,100.0f);
+
+  for( int f = 0 ; f < B::SIZE_OF_FIELD ; ++f ) {
+    auto field = Field(buffer,f);
+    for( std::size_t i = 0 ; i < kParticleSize ; ++i ) field[i] = value(gen);
+  }
+
+  aos->resize(kParticleSize);
+  for( std::size_t i = 0 ; i < kParticleSize ; ++i ) {
+    Field(buffer,B::AGE )[i] = 0.0f;
+    Field(buffer,B::LIFE)[i] = 1000.0f;
+
+    // same field order in both layout up to SIZE , the color and size
+    // deltas keep their random value
+    auto p = reinterpret_cast<float*>(&(*aos)[i]);
+    for( int f = 0 ; f < B::AGE ; ++f ) p[f] = Field(buffer,f)[i];
+    (*aos)[i].age  = 0.0f;
+    (*aos)[i].life = 1000.0f;
+  }
+}
+
+// Zero the terms of the features not in feature , like an emitter whose
+// ranges of them are [0,0]
+void Strip( detail::ParticleBuffer* buffer , unsigned feature ) {
+  typedef detail::ParticleBuffer B;
+  const B::Field kTerm[] = { B::GRAVITY , B::RADIAL_ACC , B::TANGENTIAL_ACC ,
+                             B::SPIN_DELTA };
+  for( std::size_t k = 0 ; k < 4 ; ++k ) {
+    if(feature & (1u << k)) continue;
+    std::fill(Field(buffer,kTerm[k]),Field(buffer,kTerm[k]) + kParticleSize,0.0f);
+  }
+}
+
+// Keep 1 of kSparseRatio particles alive , scattered when sparse is true
+// and packed at the front of the pool otherwise
+void Thin( detail::ParticleBuffer* buffer , bool sparse ) {
+  typedef detail::ParticleBuffer B;
+  std::mt19937 gen(7);
+  for( std::size_t i = 0 ; i < kParticleSize ; ++i ) {
+    bool alive = sparse ? gen() % kSparseRatio == 0 :
+                          i < kParticleSize / kSparseRatio;
+    if(!alive) Field(buffer,B::AGE)[i] = -1.0f;
+  }
+  if(!sparse) buffer->Allocate(kParticleSize / kSparseRatio);
+}
+
+// What rendering does , read the position of every living particle
+float Visit( const detail::ParticleBuffer& buffer , std::size_t count ,
+                                                    bool check_age ) {
+  typedef detail::ParticleBuffer B;
+  float sum = 0.0f;
+  for( std::size_t i = 0 ; i < count ; ++i ) {
+    if(check_age && buffer[B::AGE][i] < 0.0f) continue;
+    sum += buffer[B::POSITION_X][i] + buffer[B::POSITION_Y][i];
+  }
+  return sum;
+}
+
+template< typename F >
+double Measure( const char* name , std::size_t count , const F& update ) {
+  update();   // warm up
+  auto start = std::chrono::steady_clock::now();
+  for( std::size_t i = 0 ; i < kFrameSize ; ++i ) update();
+  std::chrono::duration<double> d = std::chrono::steady_clock::now() - start;
+
+  auto ms = d.count() * 1000.0 / kFrameSize;
+  std::cout << name << ": " << ms << " ms/frame , "
+            << count / (ms * 1000.0) << " M particle/s\n";
+  return ms;
+}
+
+} // namespace
+} // namespace sfe
+
+int main() {
+  using namespace sfe;
+
+  detail::ParticleBuffer scalar(kParticleSize) , simd(kParticleSize);
+  std::vector<Particle> aos;
+  Fill(&scalar,&aos);
+  Fill(&simd  ,&aos);
+
+  std::cout << kParticleSize << " particles , "
+            << sizeof(Particle) << " bytes each\n";
+
+  auto base = Measure("aos",kParticleSize,[&aos]() {
+    for( auto& e : aos ) e.Update(kDelta,0.0f,0.0f);
+  });
+  Measure("soa-scalar",kParticleSize,[&scalar]() {
+    detail::UpdateParticlesScalar(&scalar,0,kParticleSize,0.0f,0.0f,kDelta);
+  });
+  auto fast = Measure("soa-simd",kParticleSize,[&simd]() {
+    detail::UpdateParticles(&simd,0,kParticleSize,0.0f,0.0f,kDelta);
+  });
+
+  std::cout << "speedup: " << base / fast << "x\n";
+
+  std::cout << "\npool , " << kParticleSize / kSparseRatio << " of "
+            << kParticleSize << " alive\n";
+  Thin(&scalar,true );
+  Thin(&simd  ,false);
+
+  volatile float sink = 0.0f;
+  auto sparse = Measure("sentinel",kParticleSize / kSparseRatio,[&scalar,&sink]() {
+    detail::UpdateParticles(&scalar,0,kParticleSize,0.0f,0.0f,kDelta);
+    sink = sink + Visit(scalar,kParticleSize,true);
+  });
+  auto dense = Measure("dense",kParticleSize / kSparseRatio,[&simd,&sink]() {
+    if(detail::UpdateParticles(&simd,0,simd.size(),0.0f,0.0f,kDelta))
+      simd.Compact();
+    sink = sink + Visit(simd,simd.size(),false);
+  });
+  std::cout << "speedup: " << sparse / dense << "x\n";
+
+  // steady emitter , particles keep dying and spawning
+  ParticleConfig config;
+  config.max_particles = kParticleSize;
+  config.rate          = kParticleSize / kSparseRatio;
+  config.life          = FloatRange(0.5f,1.5f);
+  config.speed         = FloatRange(10.0f,100.0f);
+
+  RenderBatch batch(sf::BlendAlpha);
+  ParticleSystem system(config,&batch,sf::IntRect(0,0,8,8));
+  system.Fire();
+  for( std::size_t i = 0 ; i < 120 ; ++i ) system.Update(kDelta);
+
+  Measure("dense-emitter",system.alive_count(),[&system]() { system.Update(kDelta); });
+  std::cout << "alive: " << system.alive_count() << "\n";
+
+  std::cout << "\nrender , " << simd.size() << " particles\n"
+            << "quad per particle: " << sizeof(Particle) + sizeof(Quad)
+            << " bytes , structure of arrays: "
+            << detail::ParticleBuffer::SIZE_OF_FIELD * sizeof(float)
+            << " bytes\n";
+
+  typedef detail::ParticleBuffer B;
+  sf::IntRect rect(0,0,8,8);
+  RenderBatch quad_batch(sf::BlendAlpha);
+  quad_batch.set_quad_list(true);
+  auto quad_ms = Measure("quad",simd.size(),[&simd,&aos,&quad_batch,&rect]() {
+    Quad quad(&quad_batch,rect);
+    quad.SetAnchor(4.0f,4.0f);
+    const Quad* q = &quad;
+    auto first = quad_batch.BeginFill(simd.size());
+    for( std::size_t i = 0 ; i < simd.size() ; ++i ) {
+      auto clamp = []( float v ) {
+        return static_cast<std::uint8_t>(std::min(255.0f,std::max(0.0f,v)));
+      };
+      const auto& p = aos[i];
+      quad.SetPosition(simd[B::POSITION_X][i],simd[B::POSITION_Y][i]);
+      quad.SetRotation(simd[B::SPIN][i] * 57.2957795f);
+      quad.SetScale   (simd[B::SIZE][i],simd[B::SIZE][i]);
+      quad.SetColor   (sf::Color(clamp(p.r),clamp(p.g),clamp(p.b),clamp(p.a)));
+      quad_batch.FillQuads(first + i,&q,1);
+    }
+    quad_batch.Clear();
+  });
+
+  // fade out and grow over the life
+  ColorGradient color;
+  color.push_back(GradientStop<Color>(0.0f,Color(255,255,255,255)));
+  color.push_back(GradientStop<Color>(0.6f,Color(192,255,128,0  )));
+  color.push_back(GradientStop<Color>(1.0f,Color(0  ,64 ,64 ,64 )));
+  FloatGradient size;
+  size.push_back(GradientStop<float>(0.0f,0.5f));
+  size.push_back(GradientStop<float>(1.0f,2.0f));
+  detail::ParticleLut lut(color,size);
+
+  auto emit_ms = Measure("emit",simd.size(),[&simd,&quad_batch,&rect,&lut]() {
+    auto output = quad_batch.GetFillVertex(quad_batch.BeginFill(simd.size()));
+    detail::EmitParticleQuads(&simd,0,simd.size(),detail::ParticleShape(rect),
+                              lut,output);
+    quad_batch.Clear();
+  });
+  std::cout << "speedup: " << quad_ms / emit_ms << "x\n";
+
+  std::cout << "\nparallel , " << JobSystem::GetInstance().worker_count()
+            << " workers\n";
+  config.max_particles = kParticleSize / 4;
+  config.rate          = kParticleSize / 4;
+  config.life          = FloatRange(1000.0f,1000.0f);
+
+  RenderBatch large_batch(sf::BlendAlpha);
+  large_batch.set_quad_list(true);
+  ParticleSystem large(config,&large_batch,sf::IntRect(0,0,8,8));
+  large.Fire();
+  large.Update(1.0f);
+
+  auto frame = [&large,&large_batch]() {
+    large.Update(kDelta);
+    large.Render();
+    large_batch.Clear();
+  };
+  large.set_parallel_threshold(static_cast<std::size_t>(-1));
+  auto serial   = Measure("serial"  ,large.alive_count(),frame);
+  large.set_parallel_threshold(ParticleSystem::kDefaultParallelThreshold);
+  auto parallel = Measure("parallel",large.alive_count(),frame);
+  std::cout << "alive: " << large.alive_count() << " , speedup: "
+            << serial / parallel << "x\n";
+
+  struct Preset {
+    const char* name;
+    unsigned    feature;
+  };
+  const Preset kPreset[] = {
+    { "sparks"  , 0 },
+    { "fountain", detail::FEATURE_GRAVITY },
+    { "smoke"   , detail::FEATURE_GRAVITY | detail::FEATURE_SPIN },
+    { "vortex"  , detail::FEATURE_RADIAL_ACC | detail::FEATURE_TANGENTIAL_ACC |
+                  detail::FEATURE_SPIN },
+    { "all"     , detail::FEATURE_ALL }
+  };
+
+  std::cout << "\nkernel , " << kParticleSize << " particles\n";
+  detail::ParticleBuffer preset(kParticleSize);
+  for( const auto& p : kPreset ) {
+    Fill(&preset,&aos);
+    Strip(&preset,p.feature);
+    auto kernel = detail::GetParticleKernel(p.feature);
+
+    std::cout << p.name << "\n";
+    auto generic = Measure("  generic",kParticleSize,[&preset]() {
+      detail::UpdateParticles(&preset,0,kParticleSize,0.0f,0.0f,kDelta);
+    });
+    auto special = Measure("  special",kParticleSize,[&preset,kernel]() {
+      kernel(&preset,0,kParticleSize,0.0f,0.0f,kDelta);
+    });
+    std::cout << "  speedup: " << generic / special << "x\n";
+  }
+  return 0;
+}
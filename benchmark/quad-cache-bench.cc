@@ -0,0 +1,81 @@
+#include "render-batch.h"
+
+#include <chrono>
+#include <iostream>
+#include <memory>
+#include <vector>
+
+// Scene with 90% static and 10% moving sprites. Compares re-transforming
+// every quad each frame against Quad's cached world vertex
+
+namespace sfe {
+namespace {
+
+const std::size_t kQuadSize  = 100000;
+const std::size_t kFrameSize = 100;
+const std::size_t kMoving    = 10;      // every 10th quad moves
+
+template< typename T >
+double Measure( const char* name , RenderBatch* batch , const T& body ) {
+  auto start = std::chrono::steady_clock::now();
+  for( std::size_t i = 0 ; i < kFrameSize ; ++i ) {
+    body(i);
+    batch->Clear();
+  }
+  std::chrono::duration<double> d = std::chrono::steady_clock::now() - start;
+
+  auto ms = d.count() * 1000.0 / kFrameSize;
+  std::cout << name << ": " << ms << " ms/frame\n";
+  return ms;
+}
+
+} // namespace
+} // namespace sfe
+
+int main() {
+  using namespace sfe;
+
+  RenderBatch batch(sf::BlendAlpha);
+  batch.set_quad_list(true);
+  batch.Reserve(kQuadSize);
+
+  std::vector<std::unique_ptr<Quad>> quads(kQuadSize);
+  std::vector<sf::Transformable> trans(kQuadSize);
+  std::vector<sf::Vertex> corner;
+
+  for( std::size_t i = 0 ; i < kQuadSize ; ++i ) {
+    auto x = static_cast<float>(i % 1000);
+    auto y = static_cast<float>(i / 1000);
+    quads[i].reset(new Quad(&batch,sf::IntRect(0,0,16,16)));
+    quads[i]->SetPosition(x,y);
+    quads[i]->SetRotation(static_cast<float>(i % 360));
+    trans[i].setPosition(x,y);
+    trans[i].setRotation(static_cast<float>(i % 360));
+
+    corner.push_back(sf::Vertex(sf::Vector2f( 0, 0)));
+    corner.push_back(sf::Vertex(sf::Vector2f( 0,16)));
+    corner.push_back(sf::Vertex(sf::Vector2f(16, 0)));
+    corner.push_back(sf::Vertex(sf::Vector2f(16,16)));
+  }
+
+  // what Quad::Render used to do , transform all 4 corners every frame
+  auto uncached = Measure("transform every frame",&batch,[&]( std::size_t f ) {
+    for( std::size_t i = 0 ; i < kQuadSize ; ++i ) {
+      if(i % kMoving == 0)
+        trans[i].setPosition(static_cast<float>(f),static_cast<float>(i / 1000));
+      QuadTransform t(trans[i].getTransform());
+      batch.EnqueueQuads(&t,corner.data() + i * 4,1);
+    }
+  });
+
+  auto cached = Measure("cached world vertex  ",&batch,[&]( std::size_t f ) {
+    for( std::size_t i = 0 ; i < kQuadSize ; ++i ) {
+      if(i % kMoving == 0)
+        quads[i]->SetPosition(static_cast<float>(f),static_cast<float>(i / 1000));
+      quads[i]->Render();
+    }
+  });
+
+  std::cout << "speedup:" << uncached / cached << "x\n";
+  return 0;
+}
@@ -0,0 +1,51 @@
+#include "random.h"
+
+#include <chrono>
+#include <iostream>
+#include <random>
+#include <vector>
+
+// Cost of one uniform float , the std::mt19937 with a distribution object
+// per call the engine used before against Random one by one and in bulk
+
+namespace sfe {
+namespace {
+
+const std::size_t kCount = 1 << 20;
+const std::size_t kRound = 50;
+
+template< typename F >
+void Measure( const char* name , std::vector<float>* output , const F& fill ) {
+  fill(output);   // warm up
+  auto start = std::chrono::steady_clock::now();
+  for( std::size_t i = 0 ; i < kRound ; ++i ) fill(output);
+  std::chrono::duration<double> d = std::chrono::steady_clock::now() - start;
+
+  double sum = 0.0;
+  for( auto e : *output ) sum += e;
+  std::cout << name << ": " << d.count() * 1e9 / (kRound * kCount)
+            << " ns/value (mean:" << sum / kCount << ")\n";
+}
+
+} // namespace
+} // namespace sfe
+
+int main() {
+  using namespace sfe;
+  std::vector<float> output(kCount);
+
+  std::mt19937 gen(42);
+  Measure("mt19937",&output,[&gen]( std::vector<float>* o ) {
+    for( auto& e : *o )
+      e = std::uniform_real_distribution<>(-1.0f,1.0f)(gen);
+  });
+
+  Random rng(42);
+  Measure("random-get",&output,[&rng]( std::vector<float>* o ) {
+    for( auto& e : *o ) e = rng.Get(-1.0f,1.0f);
+  });
+  Measure("random-fill",&output,[&rng]( std::vector<float>* o ) {
+    rng.Fill(o->data(),o->size(),-1.0f,1.0f);
+  });
+  return 0;
+}
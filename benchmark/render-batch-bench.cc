@@ -0,0 +1,88 @@
+#include "render-batch.h"
+
+#include <chrono>
+#include <iostream>
+#include <memory>
+#include <vector>
+
+namespace sfe {
+namespace {
+
+const std::size_t kQuadSize  = 50000;
+const std::size_t kFrameSize = 100;
+
+// The old path , 4 Enqueue calls per quad with a full sf::Transform copy
+void EnqueuePerVertex( RenderBatch* batch , const std::vector<sf::Vertex>& corner ,
+                                            const sf::Transform& trans ) {
+  for( std::size_t i = 0 ; i < corner.size() ; ++i )
+    batch->Enqueue(corner[i],trans);
+}
+
+template< typename T >
+double Measure( const char* name , RenderBatch* batch , const T& body ) {
+  auto start = std::chrono::steady_clock::now();
+  for( std::size_t i = 0 ; i < kFrameSize ; ++i ) {
+    body();
+    batch->Clear();
+  }
+  std::chrono::duration<double> d = std::chrono::steady_clock::now() - start;
+
+  auto qps = static_cast<double>(kQuadSize * kFrameSize) / d.count();
+  std::cout << name << ": " << qps << " quads/sec\n";
+  return qps;
+}
+
+} // namespace
+} // namespace sfe
+
+int main() {
+  using namespace sfe;
+
+  RenderBatch batch(sf::BlendAlpha);
+
+  std::vector<std::unique_ptr<Quad>> quads(kQuadSize);
+  std::vector<const Quad*> quad_list;
+  std::vector<QuadTransform> trans(kQuadSize);
+  std::vector<sf::Vertex> corner;
+
+  for( std::size_t i = 0 ; i < kQuadSize ; ++i ) {
+    quads[i].reset(new Quad(&batch,sf::IntRect(0,0,32,32)));
+    quads[i]->SetPosition(static_cast<float>(i % 800),
+                          static_cast<float>(i % 600));
+    quads[i]->SetRotation(static_cast<float>(i % 360));
+    quad_list.push_back(quads[i].get());
+
+    sf::Transform t;
+    t.translate(static_cast<float>(i % 800),static_cast<float>(i % 600));
+    t.rotate(static_cast<float>(i % 360));
+    trans[i] = QuadTransform(t);
+
+    corner.push_back(sf::Vertex(sf::Vector2f( 0, 0)));
+    corner.push_back(sf::Vertex(sf::Vector2f( 0,32)));
+    corner.push_back(sf::Vertex(sf::Vector2f(32, 0)));
+    corner.push_back(sf::Vertex(sf::Vector2f(32,32)));
+  }
+
+  sf::Transform t;
+  t.translate(400,300);
+
+  auto base = Measure("Enqueue(per vertex)",&batch,[&]() {
+    EnqueuePerVertex(&batch,corner,t);
+  });
+
+  Measure("Quad::Render",&batch,[&]() {
+    for( auto& e : quads ) e->Render();
+  });
+
+  auto quad = Measure("EnqueueQuads(Quad)",&batch,[&]() {
+    batch.EnqueueQuads(quad_list.data(),quad_list.size());
+  });
+
+  auto bulk = Measure("EnqueueQuads(QuadTransform)",&batch,[&]() {
+    batch.EnqueueQuads(trans.data(),corner.data(),trans.size());
+  });
+
+  std::cout << "speedup(Quad):" << quad / base << "x\n"
+            << "speedup(QuadTransform):" << bulk / base << "x\n";
+  return 0;
+}
@@ -0,0 +1,486 @@
+#include "render-batch.h"
+#include "render-queue.h"
+#include "static-render-batch.h"
+
+#include <GL/gl.h>
+#include <atomic>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <fstream>
+#include <iostream>
+#include <map>
+#include <memory>
+#include <new>
+#include <string>
+#include <vector>
+
+// Headless rendering benchmark suite. Every scenario renders into an
+// offscreen sf::RenderTexture , so it runs under Mesa software GL , eg:
+//
+//   LIBGL_ALWAYS_SOFTWARE=1 xvfb-run ./benchmark/render-bench.b
+//
+// Options :
+//   --output   <file>   write the result as JSON
+//   --baseline <file>   compare against a previous JSON result , exits with
+//                       non zero if any scenario is slower than threshold
+//   --threshold <pct>   allowed regression in percent , default 10
+//   --frame    <n>      frames per scenario , default 100
+//   --filter   <str>    only run scenarios whose name contains str
+
+namespace {
+
+// Count the heap allocations , only the measured frames are recorded
+std::atomic<std::size_t> g_allocation(0);
+
+} // namespace
+
+void* operator new( std::size_t size ) {
+  ++g_allocation;
+  if(void* p = std::malloc(size ? size : 1)) return p;
+  throw std::bad_alloc();
+}
+
+void operator delete( void* p ) noexcept { std::free(p); }
+void operator delete( void* p , std::size_t ) noexcept { std::free(p); }
+
+namespace sfe {
+namespace {
+
+const unsigned kWidth  = 1280;
+const unsigned kHeight = 720;
+
+enum Phase {
+  PHASE_UPDATE = 0,     // simulation , moving quads
+  PHASE_BUILD,          // generating vertex , submitting into batch/queue
+  PHASE_DRAW,           // issuing draw calls
+  PHASE_DISPLAY,        // display and waiting for GL to finish
+  SIZE_OF_PHASE
+};
+
+const char* kPhaseName[] = { "update" , "build" , "draw" , "display" };
+
+struct Result {
+  std::string name;
+  double      phase_ms[SIZE_OF_PHASE];
+  double      frame_ms;
+  double      draw_call;            // per frame
+  double      vertex_per_sec;
+  double      allocation;           // per frame
+};
+
+// Shared textures for the scenarios , created in memory
+class TextureSet {
+ public:
+  explicit TextureSet( std::size_t count ) : texture_() {
+    for( std::size_t i = 0 ; i < count ; ++i ) {
+      sf::Image image;
+      image.create(32,32,sf::Color(static_cast<sf::Uint8>(i * 40),128,255));
+      texture_.emplace_back(new sf::Texture());
+      texture_.back()->loadFromImage(image);
+    }
+  }
+
+  const sf::Texture* Get( std::size_t i ) const { return texture_[i].get(); }
+  std::size_t size() const { return texture_.size(); }
+
+ private:
+  std::vector<std::unique_ptr<sf::Texture>> texture_;
+};
+
+class Scenario {
+ public:
+  virtual ~Scenario() {}
+  virtual std::string name() const = 0;
+
+  virtual void Update( std::size_t frame ) = 0;
+  virtual void Build () = 0;
+  // returns how many draw calls are issued
+  virtual std::size_t Draw( sf::RenderTarget* ) = 0;
+  // vertex drawn in the last frame
+  virtual std::size_t vertex() const = 0;
+};
+
+float Position( std::size_t i , std::size_t range ) {
+  return static_cast<float>((i * 7919) % range);
+}
+
+// N quads in a single quad list batch , every quad moves in dynamic mode
+class QuadScene : public Scenario {
+ public:
+  QuadScene( std::size_t count , bool dynamic , const TextureSet& tex ):
+    count_(count), dynamic_(dynamic), batch_(sf::BlendAlpha,tex.Get(0)),
+    quad_(), vertex_()
+  {
+    batch_.set_quad_list(true);
+    batch_.Reserve(count);
+    for( std::size_t i = 0 ; i < count ; ++i ) {
+      quad_.emplace_back(new Quad(&batch_,sf::IntRect(0,0,32,32)));
+      quad_.back()->SetPosition(Position(i,kWidth),Position(i+1,kHeight));
+    }
+  }
+
+  virtual std::string name() const {
+    return std::string(dynamic_ ? "dynamic-" : "static-") + std::to_string(count_);
+  }
+
+  virtual void Update( std::size_t frame ) {
+    if(!dynamic_) return;
+    for( std::size_t i = 0 ; i < count_ ; ++i )
+      quad_[i]->SetRotation(static_cast<float>((i + frame) % 360));
+  }
+
+  virtual void Build() {
+    for( auto& e : quad_ ) e->Render();
+  }
+
+  virtual std::size_t Draw( sf::RenderTarget* target ) {
+    vertex_ = batch_.vertex_count();
+    batch_.Render(target);
+    return 1;
+  }
+
+  virtual std::size_t vertex() const { return vertex_; }
+
+ private:
+  std::size_t count_;
+  bool        dynamic_;
+  RenderBatch batch_;
+  std::vector<std::unique_ptr<Quad>> quad_;
+  std::size_t vertex_;
+};
+
+// N quads built once into a StaticRenderBatch
+class RetainedScene : public Scenario {
+ public:
+  RetainedScene( std::size_t count , const TextureSet& tex ):
+    count_(count), dummy_(), batch_(sf::BlendAlpha,tex.Get(0))
+  {
+    std::vector<std::unique_ptr<Quad>> quad;
+    std::vector<const Quad*> list;
+    for( std::size_t i = 0 ; i < count ; ++i ) {
+      quad.emplace_back(new Quad(&dummy_,sf::IntRect(0,0,32,32)));
+      quad.back()->SetPosition(Position(i,kWidth),Position(i+1,kHeight));
+      list.push_back(quad.back().get());
+    }
+    batch_.Build(list.data(),list.size());
+  }
+
+  virtual std::string name() const {
+    return "retained-" + std::to_string(count_);
+  }
+
+  virtual void Update( std::size_t ) {}
+  virtual void Build () {}
+
+  virtual std::size_t Draw( sf::RenderTarget* target ) {
+    batch_.Render(target);
+    return 1;
+  }
+
+  virtual std::size_t vertex() const { return count_ * 4; }
+
+ private:
+  std::size_t       count_;
+  RenderBatch       dummy_;
+  StaticRenderBatch batch_;
+};
+
+// N quads spread over all textures and blend modes , submitted in random
+// order through the RenderQueue
+class MixedTextureScene : public Scenario {
+ public:
+  MixedTextureScene( std::size_t count , const TextureSet& tex ):
+    count_(count), batch_(), quad_(), queue_()
+  {
+    for( std::size_t i = 0 ; i < tex.size() ; ++i ) {
+      batch_.emplace_back(new RenderBatch(i % 2 ? sf::BlendAdd : sf::BlendAlpha,
+                                          tex.Get(i)));
+      batch_.back()->set_quad_list(true);
+    }
+
+    for( std::size_t i = 0 ; i < count ; ++i ) {
+      auto b = batch_[(i * 31) % batch_.size()].get();
+      quad_.emplace_back(new Quad(b,sf::IntRect(0,0,32,32)));
+      quad_.back()->SetPosition(Position(i,kWidth),Position(i+1,kHeight));
+    }
+  }
+
+  virtual std::string name() const {
+    return "mixed-texture-" + std::to_string(count_);
+  }
+
+  virtual void Update( std::size_t frame ) {
+    for( std::size_t i = 0 ; i < count_ ; i += 4 )
+      quad_[i]->SetRotation(static_cast<float>((i + frame) % 360));
+  }
+
+  virtual void Build() {
+    for( std::size_t i = 0 ; i < count_ ; ++i )
+      queue_.Submit(*quad_[i],static_cast<std::uint8_t>(i % 2),
+                              static_cast<std::uint32_t>(i));
+  }
+
+  virtual std::size_t Draw( sf::RenderTarget* target ) {
+    queue_.Flush(target);
+    return queue_.stats().draw_call;
+  }
+
+  virtual std::size_t vertex() const { return queue_.stats().vertex; }
+
+ private:
+  std::size_t count_;
+  std::vector<std::unique_ptr<RenderBatch>> batch_;
+  std::vector<std::unique_ptr<Quad>> quad_;
+  RenderQueue queue_;
+};
+
+// Bursts of short lived additive quads , a new burst every 30 frames
+class BurstScene : public Scenario {
+ public:
+  BurstScene( std::size_t burst , const TextureSet& tex ):
+    burst_(burst), batch_(sf::BlendAdd,tex.Get(1)), particle_(), vertex_()
+  {
+    batch_.set_quad_list(true);
+    batch_.Reserve(burst * 2);
+  }
+
+  virtual std::string name() const {
+    return "particle-burst-" + std::to_string(burst_);
+  }
+
+  virtual void Update( std::size_t frame ) {
+    if(frame % 30 == 0) {
+      for( std::size_t i = 0 ; i < burst_ ; ++i ) {
+        Particle p;
+        p.quad.reset(new Quad(&batch_,sf::IntRect(0,0,8,8)));
+        p.x  = kWidth / 2.0f;
+        p.y  = kHeight/ 2.0f;
+        p.vx = Position(i,200) - 100.0f;
+        p.vy = Position(i+7,200) - 100.0f;
+        p.life = 45;
+        particle_.push_back(std::move(p));
+      }
+    }
+
+    const float dt = 1.0f / 60.0f;
+    for( std::size_t i = 0 ; i < particle_.size() ; ) {
+      auto& p = particle_[i];
+      if(--p.life == 0) {
+        std::swap(p,particle_.back());
+        particle_.pop_back();
+        continue;
+      }
+      p.vy += 98.0f * dt;
+      p.x  += p.vx * dt;
+      p.y  += p.vy * dt;
+      p.quad->SetPosition(p.x,p.y);
+      p.quad->SetColor(sf::Color(255,200,100,static_cast<sf::Uint8>(p.life*5)));
+      ++i;
+    }
+  }
+
+  virtual void Build() {
+    for( auto& e : particle_ ) e.quad->Render();
+  }
+
+  virtual std::size_t Draw( sf::RenderTarget* target ) {
+    vertex_ = batch_.vertex_count();
+    batch_.Render(target);
+    return 1;
+  }
+
+  virtual std::size_t vertex() const { return vertex_; }
+
+ private:
+  struct Particle {
+    std::unique_ptr<Quad> quad;
+    float x , y , vx , vy;
+    int   life;
+  };
+
+  std::size_t burst_;
+  RenderBatch batch_;
+  std::vector<Particle> particle_;
+  std::size_t vertex_;
+};
+
+typedef std::chrono::steady_clock Clock;
+
+double Elapsed( Clock::time_point start ) {
+  return std::chrono::duration<double,std::milli>(Clock::now() - start).count();
+}
+
+Result Run( Scenario* s , sf::RenderTexture* target , std::size_t frame ) {
+  Result r;
+  r.name = s->name();
+  std::fill(r.phase_ms,r.phase_ms + SIZE_OF_PHASE,0.0);
+
+  // warm up , let all the buffers grow to their final size
+  for( std::size_t i = 0 ; i < 5 ; ++i ) {
+    s->Update(i); s->Build();
+    target->clear(); s->Draw(target); target->display();
+  }
+  glFinish();
+
+  std::size_t draw_call = 0;
+  std::size_t vertex    = 0;
+  auto alloc = g_allocation.load();
+
+  for( std::size_t i = 0 ; i < frame ; ++i ) {
+    auto t = Clock::now();
+    s->Update(i + 5);
+    r.phase_ms[PHASE_UPDATE] += Elapsed(t);
+
+    t = Clock::now();
+    s->Build();
+    r.phase_ms[PHASE_BUILD] += Elapsed(t);
+
+    t = Clock::now();
+    target->clear();
+    draw_call += s->Draw(target);
+    vertex    += s->vertex();
+    r.phase_ms[PHASE_DRAW] += Elapsed(t);
+
+    t = Clock::now();
+    target->display();
+    glFinish();
+    r.phase_ms[PHASE_DISPLAY] += Elapsed(t);
+  }
+
+  r.allocation = static_cast<double>(g_allocation.load() - alloc) / frame;
+  r.frame_ms   = 0.0;
+  for( auto& e : r.phase_ms ) {
+    e /= frame;
+    r.frame_ms += e;
+  }
+  r.draw_call      = static_cast<double>(draw_call) / frame;
+  r.vertex_per_sec = static_cast<double>(vertex) / (r.frame_ms * frame / 1000.0);
+  return r;
+}
+
+void WriteJson( std::ostream* output , const std::vector<Result>& result ) {
+  *output << "{\"scenario\":[\n";
+  for( std::size_t i = 0 ; i < result.size() ; ++i ) {
+    const auto& r = result[i];
+    *output << "{\"name\":\"" << r.name << "\",\"frame_ms\":" << r.frame_ms;
+    for( int p = 0 ; p < SIZE_OF_PHASE ; ++p )
+      *output << ",\"" << kPhaseName[p] << "_ms\":" << r.phase_ms[p];
+    *output << ",\"draw_call\":"      << r.draw_call
+            << ",\"vertex_per_sec\":" << r.vertex_per_sec
+            << ",\"allocation\":"     << r.allocation << "}"
+            << (i + 1 == result.size() ? "\n" : ",\n");
+  }
+  *output << "]}\n";
+}
+
+// Read name and frame_ms back from a file written by WriteJson , one
+// scenario per line
+bool ReadBaseline( const char* file , std::map<std::string,double>* output ) {
+  std::ifstream input(file);
+  if(!input) return false;
+
+  std::string line;
+  while(std::getline(input,line)) {
+    char name[128];
+    double ms;
+    if(std::sscanf(line.c_str(),"{\"name\":\"%127[^\"]\",\"frame_ms\":%lf",
+                   name,&ms) == 2)
+      (*output)[name] = ms;
+  }
+  return true;
+}
+
+} // namespace
+} // namespace sfe
+
+int main( int argc , char* argv[] ) {
+  using namespace sfe;
+
+  const char* output   = NULL;
+  const char* baseline = NULL;
+  const char* filter   = NULL;
+  double threshold     = 10.0;
+  std::size_t frame    = 100;
+
+  for( int i = 1 ; i < argc ; ++i ) {
+    if(i + 1 < argc && std::strcmp(argv[i],"--output") == 0)
+      output = argv[++i];
+    else if(i + 1 < argc && std::strcmp(argv[i],"--baseline") == 0)
+      baseline = argv[++i];
+    else if(i + 1 < argc && std::strcmp(argv[i],"--threshold") == 0)
+      threshold = std::atof(argv[++i]);
+    else if(i + 1 < argc && std::strcmp(argv[i],"--frame") == 0) {
+      // every figure is divided by the frame count
+      auto n = std::atoi(argv[++i]);
+      if(n <= 0) {
+        std::cerr << "--frame must be positive , got " << argv[i] << std::endl;
+        return -1;
+      }
+      frame = static_cast<std::size_t>(n);
+    }
+    else if(i + 1 < argc && std::strcmp(argv[i],"--filter") == 0)
+      filter = argv[++i];
+    else {
+      std::cerr << "unknown option " << argv[i] << std::endl;
+      return -1;
+    }
+  }
+
+  sf::RenderTexture target;
+  if(!target.create(kWidth,kHeight)) {
+    std::cerr << "cannot create render texture" << std::endl;
+    return -1;
+  }
+
+  TextureSet texture(8);
+
+  std::vector<std::unique_ptr<Scenario>> scenario;
+  for( std::size_t n : { 1000 , 10000 , 100000 } )
+    scenario.emplace_back(new QuadScene(n,true,texture));
+  scenario.emplace_back(new QuadScene(100000,false,texture));
+  scenario.emplace_back(new RetainedScene(100000,texture));
+  scenario.emplace_back(new MixedTextureScene(10000,texture));
+  scenario.emplace_back(new BurstScene(5000,texture));
+
+  std::vector<Result> result;
+
+  std::printf("%-22s %9s %9s %9s %9s %9s %7s %12s %7s\n","scenario","frame_ms",
+      "update","build","draw","display","draws","vertex/s","allocs");
+  for( auto& s : scenario ) {
+    if(filter && s->name().find(filter) == std::string::npos) continue;
+
+    auto r = Run(s.get(),&target,frame);
+    std::printf("%-22s %9.3f %9.3f %9.3f %9.3f %9.3f %7.1f %12.0f %7.1f\n",
+        r.name.c_str(),r.frame_ms,r.phase_ms[PHASE_UPDATE],
+        r.phase_ms[PHASE_BUILD],r.phase_ms[PHASE_DRAW],
+        r.phase_ms[PHASE_DISPLAY],r.draw_call,r.vertex_per_sec,r.allocation);
+    result.push_back(r);
+  }
+
+  if(output) {
+    std::ofstream file(output);
+    WriteJson(&file,result);
+  }
+
+  int ret = 0;
+  if(baseline) {
+    std::map<std::string,double> base;
+    if(!ReadBaseline(baseline,&base)) {
+      std::cerr << "cannot read baseline " << baseline << std::endl;
+      return -1;
+    }
+
+    for( auto& r : result ) {
+      auto itr = base.find(r.name);
+      if(itr == base.end()) continue;
+
+      auto diff = (r.frame_ms - itr->second) / itr->second * 100.0;
+      std::printf("%-22s %+7.1f%%%s\n",r.name.c_str(),diff,
+                  diff > threshold ? " REGRESSION" : "");
+      if(diff > threshold) ret = 1;
+    }
+  }
+  return ret;
+}
@@ -0,0 +1,71 @@
+#include "spatial-grid.h"
+
+#include <chrono>
+#include <iostream>
+#include <memory>
+#include <vector>
+
+// A scrolling level with 200k sprites , only a small part of them is inside
+// of the view
+
+namespace sfe {
+namespace {
+
+const std::size_t kQuadSize  = 200000;
+const std::size_t kFrameSize = 100;
+const float       kWorldSize = 20000.0f;
+
+template< typename T >
+double Measure( const char* name , RenderBatch* batch , const T& body ) {
+  std::size_t vertex = 0;
+  auto start = std::chrono::steady_clock::now();
+  for( std::size_t i = 0 ; i < kFrameSize ; ++i ) {
+    body(i);
+    vertex += batch->vertex_count();
+    batch->Clear();
+  }
+  std::chrono::duration<double> d = std::chrono::steady_clock::now() - start;
+
+  auto ms = d.count() * 1000.0 / kFrameSize;
+  std::cout << name << ": " << ms << " ms/frame , "
+            << vertex / kFrameSize / 4 << " quads/frame\n";
+  return ms;
+}
+
+} // namespace
+} // namespace sfe
+
+int main() {
+  using namespace sfe;
+
+  RenderBatch batch(sf::BlendAlpha);
+  batch.set_quad_list(true);
+  SpatialGrid grid(256.0f);
+
+  std::vector<std::unique_ptr<Quad>> quads(kQuadSize);
+  for( std::size_t i = 0 ; i < kQuadSize ; ++i ) {
+    quads[i].reset(new Quad(&batch,sf::IntRect(0,0,32,32)));
+    quads[i]->SetPosition(static_cast<float>((i * 7919) % 20000),
+                          static_cast<float>((i * 104729) % 20000));
+    grid.Insert(quads[i].get());
+  }
+
+  auto all = Measure("render all ",&batch,[&]( std::size_t ) {
+    for( auto& e : quads ) e->Render();
+  });
+
+  auto culled = Measure("grid culled",&batch,[&]( std::size_t f ) {
+    // 1% of the quads move every frame
+    for( std::size_t i = 0 ; i < kQuadSize ; i += 100 )
+      quads[i]->SetPosition(static_cast<float>((i + f * 16) % 20000),
+                            static_cast<float>((i * 104729) % 20000));
+    grid.Refresh();
+
+    sf::View view(sf::FloatRect(static_cast<float>(f * 32) ,
+                                kWorldSize / 2.0f , 1280 , 720));
+    grid.Render(view);
+  });
+
+  std::cout << "speedup:" << all / culled << "x\n";
+  return 0;
+}
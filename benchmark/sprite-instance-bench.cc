@@ -0,0 +1,64 @@
+#include "sprite-instance-batch.h"
+
+#include <GL/gl.h>
+#include <chrono>
+#include <iostream>
+
+// Renders into an offscreen sf::RenderTexture so it can run on a machine
+// without GPU , eg: LIBGL_ALWAYS_SOFTWARE=1 xvfb-run ./sprite-instance-bench.b
+
+namespace sfe {
+namespace {
+
+const std::size_t kSpriteSize = 50000;
+const std::size_t kFrameSize  = 100;
+
+double Measure( const char* name , sf::RenderTexture* target ,
+                                   SpriteInstanceBatch* batch ) {
+  auto start = std::chrono::steady_clock::now();
+  for( std::size_t f = 0 ; f < kFrameSize ; ++f ) {
+    target->clear();
+    for( std::size_t i = 0 ; i < kSpriteSize ; ++i ) {
+      batch->Enqueue(SpriteInstance::Make(
+            static_cast<float>(i % 800) , static_cast<float>(i % 600) ,
+            static_cast<float>((i + f) % 360) , 1.0f , 1.0f , 8.0f , 8.0f ,
+            sf::IntRect(0,0,16,16) , sf::Color(255,255,255,128)));
+    }
+    batch->Render(target);
+    target->display();
+  }
+  glFinish();
+  std::chrono::duration<double> d = std::chrono::steady_clock::now() - start;
+
+  auto ms = d.count() * 1000.0 / kFrameSize;
+  std::cout << name << ": " << ms << " ms/frame , upload "
+            << kSpriteSize * sizeof(SpriteInstance) / 1024 << "KB vs "
+            << kSpriteSize * sizeof(sf::Vertex) * 4 / 1024 << "KB\n";
+  return ms;
+}
+
+} // namespace
+} // namespace sfe
+
+int main() {
+  using namespace sfe;
+
+  sf::RenderTexture target;
+  if(!target.create(800,600)) {
+    std::cerr << "cannot create render texture" << std::endl;
+    return -1;
+  }
+
+  SpriteInstanceBatch batch(sf::BlendAlpha);
+
+  batch.set_force_fallback(true);
+  auto fallback = Measure("cpu expand",&target,&batch);
+
+  batch.set_force_fallback(false);
+  auto instanced = Measure("instanced ",&target,&batch);
+
+  if(!batch.instanced())
+    std::cout << "instancing is not available , both runs used the fallback\n";
+  std::cout << "speedup:" << fallback / instanced << "x\n";
+  return 0;
+}
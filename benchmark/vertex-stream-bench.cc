@@ -0,0 +1,74 @@
+#include "render-batch.h"
+
+#include <GL/gl.h>
+#include <chrono>
+#include <iostream>
+#include <memory>
+#include <vector>
+
+// Renders into an offscreen sf::RenderTexture so it can run on a machine
+// without GPU , eg: LIBGL_ALWAYS_SOFTWARE=1 xvfb-run ./vertex-stream-bench.b
+
+namespace sfe {
+namespace {
+
+const std::size_t kQuadSize  = 20000;
+const std::size_t kFrameSize = 200;
+
+double Measure( const char* name , sf::RenderTexture* target ,
+                                   RenderBatch* batch ,
+                                   const std::vector<std::unique_ptr<Quad>>& quads ) {
+  auto start = std::chrono::steady_clock::now();
+  for( std::size_t i = 0 ; i < kFrameSize ; ++i ) {
+    target->clear();
+    for( auto& e : quads ) e->Render();
+    batch->Render(target);
+    target->display();
+  }
+  glFinish();
+  std::chrono::duration<double> d = std::chrono::steady_clock::now() - start;
+
+  auto ms = d.count() * 1000.0 / kFrameSize;
+  std::cout << name << ": " << ms << " ms/frame";
+  if(batch->stream()) {
+    std::cout << " (orphan:" << batch->stream()->orphan_count()
+              << ",capacity:" << batch->stream()->capacity() << ")";
+  }
+  std::cout << "\n";
+  return ms;
+}
+
+} // namespace
+} // namespace sfe
+
+int main() {
+  using namespace sfe;
+
+  sf::RenderTexture target;
+  if(!target.create(800,600)) {
+    std::cerr << "cannot create render texture" << std::endl;
+    return -1;
+  }
+
+  if(!VertexStream::IsAvailable())
+    std::cerr << "vertex buffer is not available , stream backend falls back "
+                 "to client array" << std::endl;
+
+  RenderBatch batch(sf::BlendAlpha);
+
+  std::vector<std::unique_ptr<Quad>> quads(kQuadSize);
+  for( std::size_t i = 0 ; i < quads.size() ; ++i ) {
+    quads[i].reset(new Quad(&batch,sf::IntRect(0,0,8,8)));
+    quads[i]->SetPosition(static_cast<float>(i % 800),
+                          static_cast<float>(i % 600));
+  }
+
+  batch.set_backend(RenderBatch::CLIENT_ARRAY);
+  auto client = Measure("client-array ",&target,&batch,quads);
+
+  batch.set_backend(RenderBatch::STREAM_BUFFER);
+  auto stream = Measure("stream-buffer",&target,&batch,quads);
+
+  std::cout << "speedup:" << client / stream << "x\n";
+  return 0;
+}
@@ -2,8 +2,10 @@
 #define ADT_H_
 
 #include <dinject/dinject.h>
-#include <cstdint>
 #include <cassert>
+#include <cstddef>
+#include <cstdint>
+#include <vector>
 
 #include "random.h"
 
@@ -17,8 +19,17 @@ struct Range {
   Range() : lower() , upper () {}
   Range( const T& l , const T& u ) : lower(l) , upper(u) { assert(lower <= upper); }
 
-  // Get a random value inside of the range
-  T GetRandom() { return Random::GetInstance().Get(lower,upper); }
+  // Get a random value inside of the range , from the generator of the
+  // calling thread when rng is NULL
+  T GetRandom( Random* rng = NULL ) const {
+    return (rng ? *rng : Random::GetInstance()).Get(lower,upper);
+  }
+
+  // Fill count random values inside of the range into output , uses the
+  // bulk SIMD path of Random for float and int32
+  void FillRandom( T* output , std::size_t count , Random* rng = NULL ) const {
+    (rng ? *rng : Random::GetInstance()).Fill(output,count,lower,upper);
+  }
 
  public:
   // DINJECT
@@ -63,6 +74,19 @@ struct Color {
   void SetB( std::uint8_t v ) { b = v; }
 };
 
+// A control point of a gradient , the value at time in [0,1]. The value
+// between 2 stops is interpolated linearly
+template< typename T >
+struct GradientStop {
+  float time;
+  T     value;
+  GradientStop() : time() , value() {}
+  GradientStop( float t , const T& v ): time(t), value(v) {}
+};
+
+typedef std::vector<GradientStop<Color> > ColorGradient;
+typedef std::vector<GradientStop<float> > FloatGradient;
+
 typedef Rect<std::int32_t> IntRect;
 typedef Rect<float>        FloatRect;
 typedef Rect<double>       DoubleRect;
@@ -1,13 +1,18 @@
 #ifndef APP_H_
 #define APP_H_
 
+#include <atomic>
+#include <map>
 #include <memory>
 #include <string>
 #include <cstdint>
 
 #include <SFML/Graphics.hpp>
 
+#include "frame-pacer.h"
+
 namespace sfe {
+class RenderQueue;
 
 class App {
  public:
@@ -20,13 +25,90 @@ class App {
   App( const std::string& title , std::uint32_t fps , const std::size_t width ,
                                                       const std::size_t height );
 
+  struct Headless {
+    // Size of the offscreen sf::RenderTexture , 0 means no render target at
+    // all and HandleUpdate gets NULL
+    std::size_t width  = 0;
+    std::size_t height = 0;
+
+    // Stop after this many frames , 0 runs until Quit
+    std::size_t frame = 0;
+
+    // Every frame advances by exactly 1/fps seconds instead of the measured
+    // time , so the run is reproducible
+    bool deterministic = false;
+
+    // Keep the frame rate , otherwise frames run back to back at max speed
+    bool throttle = true;
+  };
+
+  // Initialize the application without a window , for simulation servers
+  // and benchmarks. The same callbacks run as in windowed mode
+  App( std::uint32_t fps , const Headless& );
+
  public:
-  // Get the underlying sfml RenderWindow object
+  // Get the underlying sfml RenderWindow object , NULL in headless mode
   sf::RenderWindow* window() const { return window_.get(); }
 
+  // The offscreen target in headless mode , NULL otherwise
+  sf::RenderTexture* texture() const { return texture_.get(); }
+
+  // Where the frames are drawn , the window or the offscreen texture. NULL
+  // when headless without a render target
+  sf::RenderTarget* target() const {
+    return window_ ? static_cast<sf::RenderTarget*>(window_.get()) :
+                     static_cast<sf::RenderTarget*>(texture_.get());
+  }
+
+  // Index of the current frame , starts from 0
+  std::size_t frame_index() const { return frame_index_; }
+
+  // Queue an event that is delivered to HandleEvent at the given frame ,
+  // after the window events of that frame. Not thread safe , in pipelined
+  // mode only call it before Start
+  void PushEvent( std::size_t frame , const sf::Event& event ) {
+    script_.insert(std::make_pair(frame,event));
+  }
+
+  // Exit the loop at the end of the current frame , can be called from any
+  // callback
+  void Quit() { quit_.store(true); }
+
   const sf::Color& clear_color() const { return clear_color_; }
 
   void set_clear_color( const sf::Color& col ) { clear_color_ = col; }
+
+  // Draw the FrameProfiler overlay on top of every frame
+  bool profiler_overlay() const { return profiler_overlay_; }
+  void set_profiler_overlay( bool overlay ) { profiler_overlay_ = overlay; }
+
+  // When not empty , the FrameProfiler history is dumped into this CSV file
+  // once the loop exits
+  const std::string& profiler_csv() const { return profiler_csv_; }
+  void set_profiler_csv( const std::string& file ) { profiler_csv_ = file; }
+
+  // Enable fixed timestep mode , the simulation runs rate steps per second
+  // through HandleSimulate and every frame is drawn by HandleRender instead
+  // of HandleUpdate. At most max_step simulation steps run in one frame , the
+  // time beyond is dropped so a slow frame cannot snowball. Rate 0 disables
+  // it , which is the default
+  void set_fixed_timestep( std::uint32_t rate ,
+                           std::uint32_t max_step = kDefaultMaxSimulateStep );
+  std::uint32_t fixed_rate() const { return fixed_rate_; }
+  std::uint32_t max_simulate_step() const { return max_simulate_step_; }
+
+  // Interpolation alpha of the current frame in fixed timestep mode
+  float render_alpha() const { return render_alpha_; }
+
+  // Enable pipelined mode , HandleEvent , HandleSimulate and HandleRecord
+  // run on a worker thread that records frame N+1 into a RenderQueue while
+  // the main thread flushes frame N and waits on display. HandleUpdate and
+  // HandleRender are not called. Must be set before Start
+  bool pipelined() const { return pipelined_; }
+  void set_pipelined( bool pipelined ) { pipelined_ = pipelined; }
+
+  // Frame rate pacing and its jitter statistics
+  FramePacer* pacer() { return &pacer_; }
  public:
 
   // Called before the enter the loop
@@ -36,8 +118,24 @@ class App {
   // insert the rendering code and logical/AI code
   //
   // This function will only be called when all the event is handlede , or
-  // pollEvent returns false
-  virtual void HandleUpdate( float delta , sf::RenderWindow* ) = 0;
+  // pollEvent returns false. It is not called in fixed timestep mode
+  virtual void HandleUpdate( float , sf::RenderTarget* ) {}
+
+  // Fixed timestep mode only , called 0 or more times per frame with a
+  // constant delta of 1 / fixed_rate seconds
+  virtual void HandleSimulate( float ) {}
+
+  // Fixed timestep mode only , called once per frame after the simulation
+  // steps. Alpha in [0,1) is how far the wall time is between the last and
+  // the next simulation step , used to interpolate the rendered state
+  virtual void HandleRender( float , sf::RenderTarget* ) {}
+
+  // Pipelined mode only , called on the worker thread once per frame to
+  // simulate and record the frame into the queue. The queue is flushed on
+  // the main thread while the next frame is recorded , so only submit Quad
+  // and quad list RenderBatch , whose vertex are copied on Submit ; other
+  // batches are drawn from their own storage at flush time
+  virtual void HandleRecord( float , RenderQueue* ) {}
 
   // Called when there's event needs to be handled , if this function returns
   // true , then the application will exit the loop and closed ; otherwise it
@@ -53,10 +151,45 @@ class App {
   bool Start();
 
   virtual ~App() {}
+
+  static const std::uint32_t kDefaultMaxSimulateStep = 5;
  private:
+  // Run the pending fixed steps , returns the interpolation alpha
+  float Simulate( float delta );
+
+  // Wait for the rest of the frame budget , returns the frame delta
+  float Sleep();
+
+  // Delta for the fixed timestep accumulator
+  float GetStepDelta( sf::Clock* );
+
+  bool IsRunning() const;
+  bool PollEvent( sf::Event* );
+  void Clear  ();
+  void Display();
+
+  void Run();
+  void RunPipelined();
+
   std::unique_ptr<sf::RenderWindow> window_;
+  std::unique_ptr<sf::RenderTexture> texture_;
   std::uint32_t fps_;
   sf::Color clear_color_;
+  bool profiler_overlay_;
+  std::string profiler_csv_;
+  std::uint32_t fixed_rate_;
+  std::uint32_t max_simulate_step_;
+  double accumulator_;
+  float render_alpha_;
+  bool pipelined_;
+  FramePacer pacer_;
+  std::size_t max_frame_;
+  bool deterministic_;
+  bool throttle_;
+  std::size_t frame_index_;
+  std::multimap<std::size_t,sf::Event> script_;
+  std::atomic<bool> quit_;
+  sf::Clock frame_clock_;       // unthrottled frame delta
 };
 
 } // namespace sfe
@@ -0,0 +1,65 @@
+#ifndef ATLAS_PACKER_H_
+#define ATLAS_PACKER_H_
+
+#include <SFML/Graphics.hpp>
+#include <vector>
+#include <cstdint>
+
+namespace sfe {
+
+// Skyline bottom-left rectangle packer. The skyline is the list of top
+// edges of the already placed rectangles , a new rectangle is placed at the
+// position that ends up with the lowest top edge ( and then the narrowest
+// segment ) so the wasted space below the skyline is kept small
+class SkylinePacker {
+ public:
+  SkylinePacker( int width , int height );
+
+  // Find a place for a width x height rectangle , returns false if there
+  // is no room left in this page
+  bool Insert( int width , int height , sf::IntRect* output );
+
+  void Reset();
+
+  int width () const { return width_;  }
+  int height() const { return height_; }
+
+  // Ratio of the used area against the page area
+  float occupancy() const {
+    return static_cast<float>(used_area_) /
+           (static_cast<float>(width_) * static_cast<float>(height_));
+  }
+
+ private:
+  struct Node {
+    int x , y , width;
+  };
+
+  // Check whether a width x height rectangle can be placed on top of the
+  // segment index , and output the y position if so
+  bool Fit( std::size_t index , int width , int height , int* y ) const;
+
+  void AddLevel( std::size_t index , const sf::IntRect& );
+
+  std::vector<Node> skyline_;
+  int width_;
+  int height_;
+  std::int64_t used_area_;
+};
+
+struct AtlasEntry {
+  int         page;               // -1 if the image cannot fit into a page
+  sf::IntRect rect;               // placement inside of the page
+};
+
+// Pack a list of image sizes into as few page_size x page_size pages as
+// possible. Each rectangle is surrounded by padding pixels to avoid texture
+// bleeding. The output has the same order as the input and the function
+// returns how many pages are used
+int PackAtlas( const std::vector<sf::Vector2i>& size , int page_size ,
+                                                     int padding ,
+                                                     std::vector<AtlasEntry>* output );
+
+} // namespace sfe
+
+#endif // ATLAS_PACKER_H_
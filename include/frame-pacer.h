@@ -0,0 +1,76 @@
+#ifndef FRAME_PACER_H_
+#define FRAME_PACER_H_
+
+#include <chrono>
+#include <cstdint>
+#include <iostream>
+
+namespace sfe {
+
+// Keep a stable frame rate with high precision. The OS sleep overshoots by
+// up to a few milliseconds , so Wait sleeps until a safety margin before the
+// deadline and then spins , yielding , for the last slice. The margin adapts
+// to the oversleep observed on this machine.
+//
+// Every wait records how late the wake up is compared to the deadline into
+// a jitter histogram.
+class FramePacer {
+ public:
+  typedef std::chrono::steady_clock Clock;
+
+  // Upper bound of each histogram bucket in microsecond , the last bucket
+  // holds everything beyond
+  static const int kBucketBound[];
+  static const std::size_t kBucketSize = 8;
+
+  struct Stats {
+    std::size_t frame;          // frames that waited for the deadline
+    std::size_t overrun;        // frames already late , no wait
+    double      max_jitter;     // in microsecond
+    double      mean_jitter;    // in microsecond
+    std::size_t histogram[kBucketSize];
+  };
+
+  explicit FramePacer( std::uint32_t fps );
+
+  // Wait until the end of the current frame , returns the real time in
+  // seconds since the previous Wait returned
+  float Wait();
+
+  // Restart the pacing from now , ie after a long stall or loading
+  void Reset();
+
+  void ResetStats();
+
+  // Print the histogram
+  void Dump( std::ostream* ) const;
+
+ public:
+  const Stats& stats() const { return stats_; }
+
+  std::uint32_t fps() const { return fps_; }
+  void set_fps( std::uint32_t fps );
+
+  // Current spin margin in microsecond
+  double spin_margin() const {
+    return std::chrono::duration<double,std::micro>(spin_).count();
+  }
+
+  // Disable the spin , every wait is a plain OS sleep
+  bool spin() const { return spin_enable_; }
+  void set_spin( bool enable ) { spin_enable_ = enable; }
+
+ private:
+  void Record( double jitter );
+
+  std::uint32_t     fps_;
+  Clock::duration   period_;
+  Clock::duration   spin_;
+  Clock::time_point last_;
+  bool              spin_enable_;
+  Stats             stats_;
+};
+
+} // namespace sfe
+
+#endif // FRAME_PACER_H_
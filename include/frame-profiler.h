@@ -0,0 +1,156 @@
+#ifndef FRAME_PROFILER_H_
+#define FRAME_PROFILER_H_
+
+#include "misc.h"
+
+#include <SFML/Graphics.hpp>
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <mutex>
+#include <string>
+
+namespace sfe {
+
+// Per frame phase profiler. Time spent in each named scope is accumulated
+// for the current frame , App::Start closes the frame and pushes it into a
+// ring buffer of the last kFrameSize frames which the statistics , overlay
+// and CSV dump are computed from.
+//
+// Recording a scope is lock free and can be done from any thread , the
+// ring buffer has a single writer , the thread calling EndFrame.
+class FrameProfiler {
+ public:
+  static const std::size_t kMaxScope  = 32;
+  static const std::size_t kFrameSize = 256;
+
+  // Builtin scopes recorded by App::Start
+  enum {
+    SCOPE_FRAME = 0,
+    SCOPE_EVENT,
+    SCOPE_UPDATE,
+    SCOPE_CLEAR,
+    SCOPE_DISPLAY,
+    SCOPE_SLEEP,
+    SCOPE_SIMULATE,
+    SIZE_OF_BUILTIN_SCOPE
+  };
+
+  // Rolling statistics over the frames in the ring buffer , in milliseconds
+  struct Stats {
+    double min;
+    double avg;
+    double p99;
+    double max;
+  };
+
+  static FrameProfiler& GetInstance();
+
+  // Get the id of a named scope , creates it if it doesn't exist. Returns -1
+  // when there are already kMaxScope scopes
+  int RegisterScope( const char* name );
+
+  // Add time to a scope of the current frame
+  void Record( int scope , std::uint64_t nanosecond ) {
+    accumulator_[scope].fetch_add(nanosecond,std::memory_order_relaxed);
+  }
+
+  // Close the current frame and push it into the ring buffer
+  void EndFrame();
+
+  // Drop all the recorded frames
+  void Reset();
+
+  // Returns false if the scope has no recorded frame yet
+  bool GetStats( int scope , Stats* ) const;
+
+  // Draw a stacked bar graph of the recorded frames , one bar per frame and
+  // one color per scope. If a font is set , the statistics of each scope is
+  // printed above the graph
+  void DrawOverlay( sf::RenderTarget* , const sf::Vector2f& position ) const;
+
+  // Dump all the recorded frames as CSV , one row per frame
+  bool DumpCSV( const char* file ) const;
+
+ public:
+  bool enable() const { return enable_; }
+  void set_enable( bool enable ) { enable_ = enable; }
+
+  const sf::Font* font() const { return font_; }
+  void set_font( const sf::Font* font ) { font_ = font; }
+
+  std::size_t scope_count() const {
+    return scope_count_.load(std::memory_order_acquire);
+  }
+  const std::string& scope_name( int scope ) const { return name_[scope]; }
+
+  // How many frames are recorded since the start , not only the ones still
+  // in the ring buffer
+  std::size_t frame_count() const {
+    return head_.load(std::memory_order_acquire);
+  }
+
+ private:
+  FrameProfiler();
+
+  // Copy the duration of a scope for the frames in the ring buffer , oldest
+  // first , returns how many frames are copied
+  std::size_t GetHistory( int scope , double* output ) const;
+
+  std::atomic<std::uint64_t> accumulator_[kMaxScope];
+  std::uint64_t              frame_[kFrameSize][kMaxScope];
+  std::atomic<std::size_t>   head_;
+
+  std::string                name_[kMaxScope];
+  std::atomic<std::size_t>   scope_count_;
+  std::mutex                 name_lock_;
+
+  const sf::Font*            font_;
+  bool                       enable_;
+
+  DISALLOW_COPY_AND_ASSIGN(FrameProfiler)
+};
+
+// Record the time of a C++ scope into a FrameProfiler scope
+class ProfileScope {
+ public:
+  explicit ProfileScope( int scope ):
+    scope_(scope),
+    start_(std::chrono::steady_clock::now())
+  {}
+
+  ~ProfileScope() {
+    auto& profiler = FrameProfiler::GetInstance();
+    if(scope_ >= 0 && profiler.enable()) {
+      auto d = std::chrono::steady_clock::now() - start_;
+      profiler.Record(scope_,
+          std::chrono::duration_cast<std::chrono::nanoseconds>(d).count());
+    }
+  }
+
+ private:
+  int scope_;
+  std::chrono::steady_clock::time_point start_;
+
+  DISALLOW_COPY_AND_ASSIGN(ProfileScope)
+};
+
+#define SFE_PROFILE_CONCAT_(A,B) A##B
+#define SFE_PROFILE_CONCAT(A,B)  SFE_PROFILE_CONCAT_(A,B)
+
+// Time the rest of the enclosing C++ scope under NAME , the name is only
+// looked up once per call site , eg:
+//
+//   void Player::Update() {
+//     SFE_PROFILE_SCOPE("player");
+//     ...
+//   }
+#define SFE_PROFILE_SCOPE(NAME)                                              \
+  static const int SFE_PROFILE_CONCAT(profile_id_,__LINE__) =                \
+    ::sfe::FrameProfiler::GetInstance().RegisterScope(NAME);                 \
+  ::sfe::ProfileScope SFE_PROFILE_CONCAT(profile_scope_,__LINE__)            \
+    (SFE_PROFILE_CONCAT(profile_id_,__LINE__))
+
+} // namespace sfe
+
+#endif // FRAME_PROFILER_H_
@@ -0,0 +1,68 @@
+#ifndef GL_UTIL_H_
+#define GL_UTIL_H_
+
+#include "misc.h"
+
+#include <SFML/Graphics.hpp>
+#include <vector>
+#include <cstdint>
+
+namespace sfe {
+namespace gl {
+
+// Set up the GL states for a raw GL draw call in the same way as what
+// sf::RenderTarget does for its own draw call : view , blend mode , model
+// transform , texture and shader. This allows us to use GL features that
+// SFML doesn't expose , like indexed drawing. Must be paired with EndDraw
+// which resets SFML's internal state cache
+void BeginDraw( sf::RenderTarget* , const sf::RenderStates& );
+void EndDraw  ( sf::RenderTarget* );
+
+// Query the capability of the current GL context , a context must be active
+bool IsVersionAtLeast( int major , int minor );
+bool HasExtension    ( const char* );
+
+// A shared static index buffer for drawing independent quads as triangle
+// list. Each quad has 4 vertex in Quad's order and 6 indices , 2 triangles.
+// The buffer is uploaded once and only grows , every quad batch shares it
+class QuadIndexBuffer {
+ public:
+  static QuadIndexBuffer& GetInstance();
+
+  // Make sure the index buffer can hold at least quads , requires an active
+  // GL context. Returns false when quads exceeds the 32 bits index range
+  bool Reserve( std::size_t quads );
+
+  // Bind the index buffer into GL_ELEMENT_ARRAY_BUFFER , and returns the
+  // pointer that needs to be passed into glDrawElements. If buffer object is
+  // not supported , the client side index array is returned instead
+  const void* Bind() const;
+  void Unbind() const;
+
+  std::size_t capacity() const { return capacity_; }
+
+ private:
+  QuadIndexBuffer(): index_(), capacity_(0), buffer_(0) {}
+
+  std::vector<std::uint32_t> index_;
+  std::size_t capacity_;
+  unsigned    buffer_;
+
+  DISALLOW_COPY_AND_ASSIGN(QuadIndexBuffer)
+};
+
+// Draw quads from client side vertex with the shared QuadIndexBuffer
+void DrawQuadList( sf::RenderTarget* , const sf::RenderStates& ,
+                                       const sf::Vertex* vertex ,
+                                       std::size_t quads );
+
+// Draw quads stored in a vertex buffer starting at first vertex
+void DrawQuadList( sf::RenderTarget* , const sf::RenderStates& ,
+                                       const sf::VertexBuffer& buffer ,
+                                       std::size_t first ,
+                                       std::size_t quads );
+
+} // namespace gl
+} // namespace sfe
+
+#endif // GL_UTIL_H_
@@ -0,0 +1,191 @@
+#ifndef JOB_SYSTEM_H_
+#define JOB_SYSTEM_H_
+
+#include "misc.h"
+
+#include <algorithm>
+#include <atomic>
+#include <condition_variable>
+#include <cstddef>
+#include <cstdint>
+#include <deque>
+#include <memory>
+#include <mutex>
+#include <new>
+#include <thread>
+#include <type_traits>
+#include <utility>
+#include <vector>
+
+namespace sfe {
+
+// Tracks a group of jobs , incremented when a job is submitted with it and
+// decremented once the job finishes. A job that depends on others simply
+// waits on their counter
+class JobCounter {
+ public:
+  JobCounter() : count_(0) {}
+
+  bool done() const { return count_.load(std::memory_order_acquire) == 0; }
+
+ private:
+  std::atomic<std::int32_t> count_;
+
+  friend class JobSystem;
+  DISALLOW_COPY_AND_ASSIGN(JobCounter)
+};
+
+// Fixed pool of worker threads with work stealing. Every worker and the
+// thread that creates the JobSystem own a lock free Chase-Lev deque , they
+// push and pop jobs at the bottom while idle threads steal from the top.
+// Jobs submitted from any other thread go through a locked shared queue.
+// A thread can own a deque in several JobSystem at once.
+//
+// A job is a callable stored inline. Jobs submitted by a thread owning a
+// deque come from a fixed pool per thread and never allocate , when the
+// pool or the deque is full the job simply runs inline on the submitting
+// thread. The other threads allocate their jobs on the heap.
+//
+// Wait doesn't block , the waiting thread keeps executing jobs until the
+// counter drops to zero , so jobs can spawn and wait on other jobs.
+class JobSystem {
+ public:
+  static const std::size_t kJobDataSize = 48;
+  static const std::size_t kQueueSize   = 1024;   // power of 2
+
+  // The shared instance , created by the first caller with one worker less
+  // than the hardware threads since the caller participates in Wait. The
+  // caller owns its deque 0 , App::Start creates it on the main thread
+  static JobSystem& GetInstance();
+
+  // Create worker threads , all the jobs must be waited before destruction
+  explicit JobSystem( std::size_t worker );
+  ~JobSystem();
+
+  // Submit a job , the callable must be copy/move constructible and fit in
+  // kJobDataSize bytes. The counter can be NULL
+  template< typename F >
+  void Run( JobCounter* counter , F&& function );
+
+  // Execute jobs until the counter reaches zero
+  void Wait( JobCounter* counter );
+
+  // Call function(first,last) over [begin,end) split into ranges of grain
+  // indices , and wait for all of them. The calling thread takes the first
+  // range
+  template< typename F >
+  void ParallelFor( std::size_t begin , std::size_t end , std::size_t grain ,
+                                                         const F& function );
+
+  std::size_t worker_count() const { return worker_.size(); }
+
+  // Whether the calling thread owns a deque of this system , its
+  // submissions don't allocate
+  bool owns_deque() const { return GetLocalDeque() != NULL; }
+
+ private:
+  struct Job {
+    void (*invoke)( Job* );
+    JobCounter* counter;
+    std::atomic<bool> busy;
+    bool heap;
+    alignas(std::max_align_t) unsigned char data[kJobDataSize];
+  };
+
+  // Fixed capacity Chase-Lev deque , Push and Pop are called by the owner
+  // thread only , Steal by any thread
+  class WorkDeque {
+   public:
+    WorkDeque() : top_(0), bottom_(0), buffer_(), pool_(), next_(0) {}
+
+    bool Push ( Job* );
+    Job* Pop  ();
+    Job* Steal();
+
+    // Grab a free job slot from the owner's pool , NULL if all are in use
+    Job* Allocate();
+
+   private:
+    std::atomic<std::int64_t> top_;
+    std::atomic<std::int64_t> bottom_;
+    std::atomic<Job*>         buffer_[kQueueSize];
+    Job                       pool_[kQueueSize];
+    std::size_t               next_;
+  };
+
+  template< typename F >
+  static void Invoke( Job* job ) {
+    auto f = reinterpret_cast<F*>(job->data);
+    (*f)();
+    f->~F();
+  }
+
+  // The deque owned by the calling thread , NULL if it doesn't own one
+  WorkDeque* GetLocalDeque() const;
+
+  // Index of the deque owned by the calling thread , deque_.size() if it
+  // doesn't own one
+  std::size_t GetLocalIndex() const;
+
+  Job* Allocate( WorkDeque* );
+  void Submit  ( WorkDeque* , Job* );
+  Job* FindJob ( WorkDeque* );
+  void Execute ( Job* );
+
+  void WorkerMain( std::size_t index );
+
+  std::uint64_t id_;                                // key of the owners
+  std::vector<std::unique_ptr<WorkDeque>> deque_;   // 0 is the creator's
+  std::vector<std::thread> worker_;
+
+  std::mutex        shared_lock_;
+  std::deque<Job*>  shared_;
+
+  std::atomic<std::int64_t> pending_;     // submitted but not started jobs
+  std::atomic<std::int32_t> sleeping_;
+  std::mutex                sleep_lock_;
+  std::condition_variable   sleep_cond_;
+  std::atomic<bool>         quit_;
+
+  DISALLOW_COPY_AND_ASSIGN(JobSystem)
+};
+
+template< typename F >
+void JobSystem::Run( JobCounter* counter , F&& function ) {
+  typedef typename std::decay<F>::type Fn;
+  static_assert(sizeof(Fn)  <= kJobDataSize , "job is too large");
+  static_assert(alignof(Fn) <= alignof(std::max_align_t) , "job is overaligned");
+
+  auto local = GetLocalDeque();
+  Job* job   = Allocate(local);
+  if(!job) {
+    function();
+    return;
+  }
+
+  new (job->data) Fn(std::forward<F>(function));
+  job->invoke  = &Invoke<Fn>;
+  job->counter = counter;
+  if(counter) counter->count_.fetch_add(1,std::memory_order_relaxed);
+  Submit(local,job);
+}
+
+template< typename F >
+void JobSystem::ParallelFor( std::size_t begin , std::size_t end ,
+                             std::size_t grain , const F& function ) {
+  if(begin >= end) return;
+  grain = std::max<std::size_t>(1,grain);
+
+  JobCounter counter;
+  for( std::size_t b = begin + grain ; b < end && b > begin ; b += grain ) {
+    auto e = std::min(end,b + grain);
+    Run(&counter,[&function,b,e]() { function(b,e); });
+  }
+
+  function(begin,std::min(end,begin + grain));
+  Wait(&counter);
+}
+
+} // namespace sfe
+
+#endif // JOB_SYSTEM_H_
@@ -1,128 +1,291 @@
 #ifndef PARTICLE_SYSTEM_H_
 #define PARTICLE_SYSTEM_H_
-#include <memory>
-#include <cstdint>
-
-#include <SFML/Graphics.h>
-#include <dinject/dinject.h>
 
 #include "adt.h"
+#include "misc.h"
+#include "random.h"
+#include "render-batch.h"
+
+#include <SFML/Graphics.hpp>
 
+#include <cassert>
+#include <cstddef>
+#include <cstdint>
+#include <cstdlib>
+#include <memory>
+#include <string>
 
 namespace sfe {
 namespace detail {
 
-struct Particle {
-  Particle():
-    position_x(),
-    position_y(),
-    velocity_x(),
-    velocity_y(),
-    gravity   (),
-    radial_acc(),
-    tangential_acc(),
-    spin      (),
-    spin_acc  (),
-    size      (),
-    size_delta(),
-    color     (),
-    delta_r   (),
-    delta_g   (),
-    delta_b   (),
-    delta_a   (),
-    life      (),
-    age       (-1.0f),
-    sprite    ()
-  {}
-
-  void Init( float pos_x , float pos_y ,
-             float vel_x , float vel_y ,
-             float grav,
-             float racc,
-             float tacc,
-             float sp , float sacc,
-             float sz , float del_sz,
-             std::uint8_t col_r ,
-             std::uint8_t col_g ,
-             std::uint8_t col_b ,
-             std::uint8_t col_a,
-             float del_r , float del_g , float del_b , float del_a ,
-             float l ) {
-    position_x = pos_x; position_y = pos_y;
-    velocity_x = vel_x; velocity_y = vel_y;
-    gravity = grav;
-    radial_acc = racc;
-    tangential_acc = tacc;
-    spin = sp; spin_acc = sacc;
-    size = sz; size_delta = del_sz;
-    color.r = col_r; color.g = col_g; color.b = col_b; color.a = col_a;
-    delta_r = del_r; delta_g = del_g; delta_b = del_b; delta_a = del_a;
-    life = l;
-    age = 0.0f;
+// Structure of arrays storage of the particles. Every field lives in its own
+// 32 bytes aligned array , so the update kernel loads the same field of 4(SSE)
+// or 8(AVX) particles with a single instruction and never touches the fields
+// it doesn't need. The capacity is rounded up to kLaneSize.
+//
+// The color and the size over the life of a particle are not stored , they
+// are looked up from the ParticleLut of the system by the normalized age.
+//
+// The pool is dense , the living particles always occupy [0,size). A slot
+// is dead when its age is negative , the update kernel marks the particles
+// that die and Compact moves the last living particle into their slot. The
+// slots beyond size are kept dead so the kernel can run over whole lanes
+class ParticleBuffer {
+ public:
+  static const std::size_t kLaneSize  = 8;
+  static const std::size_t kAlignment = 32;
+
+  enum Field {
+    POSITION_X,
+    POSITION_Y,
+    VELOCITY_X,
+    VELOCITY_Y,
+    GRAVITY,
+    RADIAL_ACC,
+    TANGENTIAL_ACC,
+    SPIN,           // rotation in radian
+    SPIN_DELTA,     // radian per second
+    SIZE,           // scale of the size over life
+    AGE,
+    LIFE,
+    SIZE_OF_FIELD
+  };
+
+  explicit ParticleBuffer( std::size_t capacity );
+
+  float*       operator [] ( Field f )       { return field_[f]; }
+  const float* operator [] ( Field f ) const { return field_[f]; }
+
+  std::size_t capacity() const { return capacity_; }
+
+  // Number of living particles
+  std::size_t size() const { return size_; }
+
+  // Append count particles after the living ones and returns the index of
+  // the first one , the caller initializes all of their fields
+  std::size_t Allocate( std::size_t count ) {
+    assert( size_ + count <= capacity_ );
+    auto first = size_;
+    size_ += count;
+    return first;
   }
 
-  bool IsStart() const { return age >= 0.0f; }
-  bool IsDead () const { return age < 0.0f;  }
+  // Remove the dead particles in [0,size) by swapping the last living one
+  // into their slot. The order of the survivors only depends on which ones
+  // died , so it is deterministic
+  void Compact();
 
-  void Update( float delta );
+  // Kill all the particles
+  void Clear();
 
- public:
-  float position_x , position_y ;
-  float velocity_x , velocity_y ;
-  float gravity;
-  float radial_acc;
-  float tangential_acc;
-  float spin;
-  float spin_acc;
-  float size;
-  float size_delta;
-  sf::Color color;
-  float delta_r , delta_g , delta_b , delta_a;
-  float life;
-  float age;
-  Quad sprite;
+ private:
+  // Copy every field of slot from into slot to
+  void Move( std::size_t from , std::size_t to ) {
+    for( int i = 0 ; i < SIZE_OF_FIELD ; ++i ) field_[i][to] = field_[i][from];
+  }
+
+  struct Free {
+    void operator () ( float* ptr ) const { std::free(ptr); }
+  };
+
+  std::unique_ptr<float,Free> data_;
+  float*      field_[SIZE_OF_FIELD];
+  std::size_t capacity_;
+  std::size_t size_;
+
+  DISALLOW_COPY_AND_ASSIGN(ParticleBuffer)
+};
+
+// Advance the living particles in [first,last) by delta seconds and returns
+// how many of them died , they are marked dead but not removed. The radial
+// and tangential acceleration are relative to the emitter at
+// (origin_x,origin_y). first must be a multiple of kLaneSize. Uses AVX or
+// SSE when the build enables them
+std::size_t UpdateParticles( ParticleBuffer* , std::size_t first ,
+                                               std::size_t last ,
+                                               float origin_x ,
+                                               float origin_y ,
+                                               float delta );
+
+// The optional terms of the update. An emitter whose range of a term is
+// always 0 doesn't need it , and the kernel of its feature set leaves the
+// term and the fields it reads out
+enum ParticleFeature {
+  FEATURE_GRAVITY        = 1,
+  FEATURE_RADIAL_ACC     = 2,
+  FEATURE_TANGENTIAL_ACC = 4,
+  FEATURE_SPIN           = 8,    // SPIN_DELTA
+  FEATURE_ALL            = 15,
+  SIZE_OF_FEATURE_SET    = 16
 };
 
-class ParticleEmitter;
+// Same signature as UpdateParticles
+typedef std::size_t (*ParticleKernel)( ParticleBuffer* , std::size_t first ,
+                                                         std::size_t last ,
+                                                         float origin_x ,
+                                                         float origin_y ,
+                                                         float delta );
+
+// The update kernel instantiated for the feature set , a bitmask of
+// ParticleFeature. It gives the same result as UpdateParticles as long as
+// the fields of the missing features are 0
+ParticleKernel GetParticleKernel( unsigned feature );
+
+// Same as UpdateParticles without SIMD , one particle at a time
+std::size_t UpdateParticlesScalar( ParticleBuffer* , std::size_t first ,
+                                                     std::size_t last ,
+                                                     float origin_x ,
+                                                     float origin_y ,
+                                                     float delta );
+
+// The color and the size of a particle over its life , the gradients of the
+// config baked into kSize samples evenly spaced over the normalized age
+// age/life. A particle looks up the sample closest to its age
+struct ParticleLut {
+  static const std::size_t kSize = 64;
+
+  sf::Color color[kSize];
+  float     size [kSize];
+
+  // An empty color gradient is white and an empty size gradient is 1
+  ParticleLut( const ColorGradient& , const FloatGradient& );
+};
+
+// The quad of a particle , the texture rect centered on the particle
+struct ParticleShape {
+  float half_width;
+  float half_height;
+  float left , top , right , bottom;    // texture coordinate
+
+  explicit ParticleShape( const sf::IntRect& texture_rect );
+};
+
+// Write the 4 world vertex of every particle in [first,last) into output ,
+// in the same order as Quad. The quad is rotated by SPIN and scaled by SIZE
+// and the size of the lut around the particle position , colored by the
+// color of the lut. The vertex are computed straight from the
+// fields , kLaneSize particles at a time with AVX or SSE , instead of going
+// through sf::Transformable. first must be a multiple of kLaneSize
+void EmitParticleQuads( ParticleBuffer* , std::size_t first ,
+                                          std::size_t last ,
+                                          const ParticleShape& ,
+                                          const ParticleLut& ,
+                                          sf::Vertex* output );
 
 } // namespace detail
 
+// Settings of a ParticleSystem. The per particle values are picked randomly
+// inside of their range when the particle is spawned
+struct ParticleConfig {
+  std::uint32_t max_particles;
+  float         rate;             // particles emitted per second
+  float         full_life;        // emitter life in seconds , negative is forever
+  float         direction;        // in radian
+  float         spread;           // direction varies inside of +-spread/2
+  FloatRange    speed;
+  FloatRange    spawn_x;          // offset to the emitter position
+  FloatRange    spawn_y;
+  FloatRange    life;
+  FloatRange    gravity;
+  FloatRange    radial_acc;
+  FloatRange    tangential_acc;
+  FloatRange    size;             // scale of the texture rect
+  FloatRange    spin;             // initial rotation in radian
+  FloatRange    spin_delta;
+  ColorGradient color_over_life;  // over the normalized age , white if empty
+  FloatGradient size_over_life;   // multiplies size , 1 if empty
+  std::uint64_t seed;             // of the system's random stream , 0 picks
+                                  // a random seed
+
+  ParticleConfig();
+
+ public:
+  // DINJECT , the gradients in the format of util::ParseGradient
+  void SetColorOverLife( const std::string& );
+  void SetSizeOverLife ( const std::string& );
+};
+
+// A particle emitter. The particles are simulated in world space , moving
+// the emitter doesn't move the particles already spawned.
+//
+// Large emitters update and render in chunks of kParallelChunk particles on
+// the shared JobSystem. Every chunk writes its own range of particles and of
+// batch vertex , so no lock is needed. Spawning and removing the dead
+// particles stay on the calling thread , the result doesn't depend on the
+// number of workers
 class ParticleSystem {
  public:
+  static const std::size_t kParallelChunk            = 4096;
+  static const std::size_t kDefaultParallelThreshold = 16384;
+
+  // The particles are rendered as quads of texture_rect , centered at their
+  // position , into the batch
+  ParticleSystem( const ParticleConfig& , RenderBatch* batch ,
+                                          const sf::IntRect& texture_rect );
+
+  // Start emitting from the beginning of the emitter life
+  void Fire();
+
+  // Stop emitting , the living particles are removed as well if kill is true
+  void Stop( bool kill = false );
+
+  // Restart the random stream of this system , the same seed and the same
+  // sequence of calls spawn the same particles
+  void Seed( std::uint64_t seed );
+
+  // Move the emitter
+  void MoveTo( float x , float y ) { position_x_ = x; position_y_ = y; }
+
+  // Simulate the living particles and emit the new ones
+  void Update( float delta );
+
+  // Enqueue all the living particles into the batch
+  void Render();
+
+ public:
+  const ParticleConfig& config() const { return config_; }
+
+  const detail::ParticleBuffer& buffer() const { return buffer_; }
+
+  std::size_t alive_count() const { return buffer_.size(); }
 
+  bool emitting() const { return emitting_; }
+
+  // Below this many living particles Update and Render run on the calling
+  // thread only , small emitters don't pay for the synchronization
+  std::size_t parallel_threshold() const { return parallel_threshold_; }
+  void set_parallel_threshold( std::size_t threshold ) {
+    parallel_threshold_ = threshold;
+  }
+
+  // Nothing to emit and nothing to render
+  bool dead() const { return !emitting_ && alive_count() == 0; }
+
+  // The features of the update kernel , picked from the config
+  unsigned feature() const { return feature_; }
 
  private:
-  FloatRect     frame_;
-  std::uint32_t max_particles_;
-  double        full_life_;
-  double        direction_;
-  double        spread_;
-  DoubleRange   speed_;
-  DoubleRange   spawn_x_;
-  DoubleRange   spawn_y_;
-  DoubleRange   life_;
-  DoubleRange   gravity_;
-  DoubleRange   raidal_acc_;
-  DoubleRange   tangential_acc_;
-  DoubleRange   size_;
-  DoubleRange   size_delta_;
-  DoubleRange   spin_;
-  DoubleRange   spin_delta_;
-  Color         color_start_;
-  Color         color_end_;
-  float         color_delta_;
+  // Spawn count particles at the end of the pool , bounded by max_particles
+  void Spawn( std::size_t count );
+
+  ParticleConfig         config_;
+  detail::ParticleBuffer buffer_;
+  float                  position_x_;
+  float                  position_y_;
 
   // field for tracking status of ParticleSystem
-  std::unique_ptr<ParticleEmitter> emitter_;
-  std::size_t emitted_particle_;
-  std::size_t dead_particle_;
-  bool dead_;
-  bool need_spwan_;
-  float age_;
-  float rate_;
-  float last_emit_time_;
-
-  std::unique_ptr<RenderBatch> render_batch_;
+  bool        emitting_;
+  float       age_;
+  float       emit_residue_;      // fraction of a particle not emitted yet
+  std::size_t parallel_threshold_;
+  unsigned    feature_;
+  Random      rng_;
+
+  RenderBatch*          batch_;
+  detail::ParticleShape shape_;
+  detail::ParticleLut   lut_;
+
+  DISALLOW_COPY_AND_ASSIGN(ParticleSystem)
 };
 
 } // namespace sfe
@@ -1,38 +1,106 @@
 #ifndef RANDOM_H_
 #define RANDOM_H_
 
+#include <algorithm>
+#include <cmath>
+#include <cstddef>
+#include <cstdint>
 #include <limits>
-#include <random>
 
 namespace sfe {
 
+// xoshiro128+ pseudo random generator. It is a lot cheaper than
+// std::mt19937 with a std::uniform_*_distribution and the state is 16
+// bytes , so every thread and every system can own its stream.
+//
+// The bulk Fill APIs run kLaneSize interleaved streams , seeded from the
+// same seed , with SSE2 when the build enables it. The values only depend
+// on the seed , not on the SIMD support
 class Random {
  public:
+  static const std::size_t kLaneSize = 8;
+
+  // The generator of the calling thread , seeded randomly on first use
   static Random& GetInstance();
 
+  explicit Random( std::uint64_t seed ) { Seed(seed); }
+
+  // Restart the streams from seed
+  void Seed( std::uint64_t seed );
+
+  // 32 random bits
+  inline std::uint32_t Next();
+
+  // Uniform in [0,1)
+  float NextFloat() { return (Next() >> 8) * (1.0f / 16777216.0f); }
+
+  // Uniform in [l,u] for integer and [l,u) for floating point , l + (u-l)*x
+  // can round up to u so the result is clamped below u
   template< typename T > T Get    ( const T& , const T& );
   template< typename T > T GetInt ( const T& , const T& );
   template< typename T > T GetReal( const T& , const T& );
+
+ public:
+  // Bulk generation , fill count values into output
+  void FillBits( std::uint32_t* output , std::size_t count );
+
+  // Uniform in [l,u)
+  void Fill( float* output , std::size_t count , float l , float u );
+
+  // Uniform in [l,u]
+  void Fill( std::int32_t* output , std::size_t count , std::int32_t l ,
+                                                        std::int32_t u );
+
+  // Any other type goes through Get one value at a time
+  template< typename T >
+  void Fill( T* output , std::size_t count , const T& l , const T& u ) {
+    for( std::size_t i = 0 ; i < count ; ++i ) output[i] = Get(l,u);
+  }
+
  private:
-  Random(): rd_(), gen_(rd_()) {}
-  std::random_device rd_;
-  std::mt19937       gen_;
+  static std::uint32_t Rotate( std::uint32_t x , int k ) {
+    return (x << k) | (x >> (32 - k));
+  }
+
+  // Advance the bulk streams by one step , kLaneSize values into output
+  void NextLane( std::uint32_t* output );
+
+  std::uint32_t state_[4];
+  alignas(16) std::uint32_t lane_[4][kLaneSize];
 };
 
+inline std::uint32_t Random::Next() {
+  auto result = state_[0] + state_[3];
+  auto t      = state_[1] << 9;
+
+  state_[2] ^= state_[0];
+  state_[3] ^= state_[1];
+  state_[1] ^= state_[2];
+  state_[0] ^= state_[3];
+  state_[2] ^= t;
+  state_[3]  = Rotate(state_[3],11);
+  return result;
+}
+
 template< typename T >
 T Random::GetInt( const T& l , const T& u ) {
-  return std::uniform_int_distribution<>(l,u)(gen_);
+  // multiply and shift maps 32 bits into the range without a division
+  auto range = static_cast<std::uint64_t>(u - l) + 1;
+  return l + static_cast<T>((static_cast<std::uint64_t>(Next()) * range) >> 32);
 }
 
 template< typename T >
 T Random::GetReal( const T& l , const T& u ) {
-  return std::uniform_real_distribution<>(l,u)(gen_);
+  return std::min(l + (u - l) * static_cast<T>(NextFloat()),std::nextafter(u,l));
 }
 
 template< typename T >
 T Random::Get( const T& l , const T& u ) {
-  return std::numeric_limits<T>::is_integer ? GetInt(l,u):
-                                              GetReal(l,u);
+  // GetReal only compiles for floating point
+  if constexpr (std::numeric_limits<T>::is_integer)
+    return GetInt(l,u);
+  else
+    return GetReal(l,u);
 }
 
 } // namespace sfe
@@ -2,38 +2,105 @@
 #define RENDER_BATCH_H_
 
 #include "misc.h"
+#include "vertex-stream.h"
+#include "gl-util.h"
 
 #include <SFML/Graphics.hpp>
 
 #include <dinject/dinject.h>
+#include <vector>
+#include <memory>
+#include <algorithm>
+#include <cstdint>
 #include <cassert>
 #include <cmath>
+#include <cstring>
 
 namespace sfe {
 
 class Quad;
 
+// A compact 2D affine transformation , it holds the upper 2x3 part of the
+// sf::Transform matrix. The bulk quad path uses it instead of sf::Transform
+// so we don't need to copy a full 4x4 matrix around for every vertex
+struct QuadTransform {
+  float a , b , tx;
+  float c , d , ty;
+
+  QuadTransform(): a(1.0f), b(0.0f), tx(0.0f), c(0.0f), d(1.0f), ty(0.0f) {}
+  inline explicit QuadTransform( const sf::Transform& );
+};
+
+// Transform the 4 local corners of a quad into output , with SIMD if it is
+// supported. Color and texture coordinate are copied as is
+void TransformQuad( const QuadTransform& , const sf::Vertex* corner ,
+                                           sf::Vertex* output );
+
 class RenderBatch {
  public:
+  // How the enqueued vertex reach the GPU
+  enum Backend {
+    // Draw from client side memory , the driver copies the whole array
+    // from user memory on every Render call
+    CLIENT_ARRAY,
+
+    // Upload into a GPU resident VertexStream and draw from there. If the
+    // GL implementation doesn't support vertex buffer objects the batch
+    // silently falls back to CLIENT_ARRAY
+    STREAM_BUFFER
+  };
+
   RenderBatch( sf::BlendMode bm , const sf::Texture* texture = NULL ,
                                   const sf::Shader*  shader  = NULL ,
-                                  sf::PrimitiveType type = sf::TriangleStrip ):
-    varray_    (type),
+                                  sf::PrimitiveType type = sf::TriangleStrip ,
+                                  Backend backend = CLIENT_ARRAY ):
+    vertex_    (),
+    type_      (type),
     blend_mode_(bm),
     texture_   (texture),
-    shader_    (shader)
+    shader_    (shader),
+    backend_   (backend),
+    quad_list_ (false),
+    reserve_   (0),
+    stream_    ()
   {}
 
   RenderBatch():
-    varray_    (sf::TriangleStrip),
+    vertex_    (),
+    type_      (sf::TriangleStrip),
     blend_mode_(),
     texture_   (),
-    shader_    ()
+    shader_    (),
+    backend_   (CLIENT_ARRAY),
+    quad_list_ (false),
+    reserve_   (0),
+    stream_    ()
   {}
 
   const sf::BlendMode& blend_mode() const { return blend_mode_; }
   const sf::Texture*   texture()    const { return texture_;    }
   const sf::Shader*    shader ()    const { return shader_;     }
+  sf::PrimitiveType    type  ()     const { return type_;       }
+  Backend              backend()    const { return backend_;    }
+
+  // Switch the backend , the GPU buffer is created lazily on the next
+  // Render call since it requires an active GL context
+  void set_backend( Backend backend ) { backend_ = backend; }
+
+  // In quad list mode every 4 enqueued vertex form an independent quad and
+  // the primitive type is ignored. The quads are drawn as triangle list with
+  // the shared QuadIndexBuffer , so a single Render call can draw thousands
+  // of sprites without stitching them together like TriangleStrip does
+  bool quad_list() const { return quad_list_; }
+  void set_quad_list( bool quad_list ) { quad_list_ = quad_list; }
+
+  // Get the streaming buffer , returns NULL if STREAM_BUFFER backend is not
+  // used or not available
+  const VertexStream* stream() const { return stream_.get(); }
+
+  // How many vertex has been enqueued but not rendered yet
+  std::size_t vertex_count() const { return vertex_.size(); }
+  const sf::Vertex* vertex() const { return vertex_.data(); }
 
   // Render all enqueued Quad object into the underlying render target
   void Render  ( sf::RenderTarget* );
@@ -44,19 +111,94 @@ class RenderBatch {
   // object
   void Enqueue ( const sf::Vertex& vert , const sf::Transform& trans );
 
+  // Bulk version of Enqueue. Each quad has one transform and 4 local space
+  // corner vertex which are laid out contiguously in the same order as Quad
+  // does. All the corners are transformed with SIMD and written directly into
+  // the vertex storage without going through append one by one
+  void EnqueueQuads( const QuadTransform* trans , const sf::Vertex* corner ,
+                                                  std::size_t count );
+
+  // Enqueue a list of Quad objects in one shot
+  void EnqueueQuads( const Quad* const* quad , std::size_t count );
+
+  // Enqueue 4 already transformed vertex of a quad
+  inline void EnqueueQuadVertex( const sf::Vertex* vertex );
+
+ public:
+  // Parallel fill API. BeginFill grows the vertex storage by count quads
+  // up front and returns the index of the first new quad. Worker threads
+  // can then call FillQuads concurrently as long as their quad ranges don't
+  // overlap , and the main thread issues Render after all of them finished.
+  // A Quad must not appear in more than one range since filling updates
+  // its cached world vertex
+  std::size_t BeginFill( std::size_t count ) {
+    assert( vertex_.size() % 4 == 0 );
+    auto first = vertex_.size() / 4;
+    vertex_.resize(vertex_.size() + count * 4);
+    return first;
+  }
+
+  // The storage of quad first onwards , for producers that compute the world
+  // vertex themselves. The same rules as FillQuads apply
+  sf::Vertex* GetFillVertex( std::size_t first ) {
+    assert( first * 4 <= vertex_.size() );
+    return vertex_.data() + first * 4;
+  }
+
+  void FillQuads( std::size_t first , const Quad* const* quad , std::size_t count );
+  void FillQuads( std::size_t first , const QuadTransform* trans ,
+                                      const sf::Vertex* corner ,
+                                      std::size_t count );
+
+  // Split the quads into job_count disjoint ranges and fill them as jobs on
+  // the shared JobSystem , the calling thread fills the first range
+  void EnqueueQuadsParallel( const Quad* const* quad , std::size_t count ,
+                                                      std::size_t job_count );
+
+  // Drop all the enqueued vertex without rendering them
+  void Clear() { vertex_.clear(); }
+
+  // Reserve storage for n_quads quads , so the batch doesn't need to grow
+  // while enqueuing. The GPU side buffers are sized on the next Render
+  inline void Reserve( std::size_t n_quads );
+
  private:
   // DINJECT APIs
   void SetBlendMode( const std::string& );
   void SetTexture  ( const std::string& );
   void SetShader   ( const std::string& );
+  void SetBackend  ( const std::string& );
+  void SetQuadList ( bool quad_list ) { quad_list_ = quad_list; }
 
   DINJECT_FRIEND_REGISTRY(RenderBatch);
 
  private:
-  sf::VertexArray    varray_;
+  // Try to draw the pending vertex through the VertexStream , returns false
+  // if the stream backend cannot be used
+  bool RenderStream( sf::RenderTarget* , const sf::RenderStates& );
+
+  // Copy the cached world vertex of the quads into output , refreshing the
+  // dirty ones first
+  static void CopyQuads( const Quad* const* quad , std::size_t count ,
+                                                   sf::Vertex* output );
+
+ private:
+  // We keep the vertex in a plain std::vector instead of sf::VertexArray so
+  // the bulk path can write into it directly. The capacity is kept across
+  // frames since Render only clears it
+  std::vector<sf::Vertex> vertex_;
+  sf::PrimitiveType  type_;
   sf::BlendMode      blend_mode_;
   const sf::Texture* texture_;
   const sf::Shader*  shader_;
+  Backend            backend_;
+  bool               quad_list_;
+  std::size_t        reserve_;   // reserved quads
+
+  // Only the vertex enqueued since last Render is uploaded into the stream
+  std::unique_ptr<VertexStream> stream_;
+
+  DISALLOW_COPY_AND_ASSIGN(RenderBatch)
 };
 
 // A quad shape objects , or the normal sprite to be rendered. The name
@@ -66,10 +208,12 @@ class Quad : protected sf::Transformable {
  public:
   inline Quad( RenderBatch* , const sf::IntRect& );
 
-  void SetPosition( float x , float y ) { Base::setPosition(x,y); }
-  void SetRotation( float rot )         { Base::setRotation(rot); }
-  void SetScale   ( float x , float y ) { Base::setScale(x,y);    }
-  void SetAnchor  ( float x , float y ) { Base::setOrigin(x,y);   }
+  // The setters only mark the cached world vertex dirty when the value is
+  // actually changed , so a quad that doesn't move costs nothing to render
+  inline void SetPosition( float x , float y );
+  inline void SetRotation( float rot );
+  inline void SetScale   ( float x , float y );
+  inline void SetAnchor  ( float x , float y );
 
   inline void GetPosition( float* x , float* y ) const;
   void GetRotation( float* rot ) const { *rot = Base::getRotation(); }
@@ -84,27 +228,115 @@ class Quad : protected sf::Transformable {
   inline void SetTextureRect( const sf::IntRect& );
   const sf::IntRect& GetTextureRect() const { return texture_rect_; }
 
+  // Get the 4 world space vertex of this quad , they are cached and only
+  // recomputed when the quad is changed
+  inline const sf::Vertex* GetWorldVertex() const;
+  void GetWorldVertex( sf::Vertex* output ) const {
+    std::memcpy(output,GetWorldVertex(),sizeof(world_));
+  }
+
+  // Get the axis aligned bounding box of the world vertex
+  inline sf::FloatRect GetWorldBounds() const;
+
+  // A counter that is bumped every time the world vertex position changes ,
+  // used by observers like SpatialGrid to detect moved quads
+  std::uint32_t version() const { return version_; }
+
   // Get the corresponding render batch
   RenderBatch* batch() const { return batch_; }
 
   // Render this sprite into the underlying RenderBatch object
-  inline void Render();
+  inline void Render() const;
 
  private:
   RenderBatch* batch_;
   sf::IntRect  texture_rect_;
-  sf::Vertex   vertex_[4];
+  sf::Vertex   vertex_[4];                 // local space vertex
+  mutable sf::Vertex world_[4];            // cached world space vertex
+  mutable bool       dirty_;
+  std::uint32_t      version_;
 
   friend class RenderBatch;
   DISALLOW_COPY_AND_ASSIGN(Quad)
 };
 
+inline QuadTransform::QuadTransform( const sf::Transform& trans ) {
+  const float* m = trans.getMatrix();
+  a = m[0]; b = m[4]; tx = m[12];
+  c = m[1]; d = m[5]; ty = m[13];
+}
+
+inline void RenderBatch::Reserve( std::size_t n_quads ) {
+  vertex_.reserve(n_quads * 4);
+  reserve_ = n_quads;
+}
+
+inline void RenderBatch::EnqueueQuadVertex( const sf::Vertex* vertex ) {
+  auto base = vertex_.size();
+  vertex_.resize(base + 4);
+  std::memcpy(vertex_.data() + base,vertex,sizeof(sf::Vertex) * 4);
+}
+
 inline Quad::Quad( RenderBatch* batch , const sf::IntRect& texture_rect ):
   batch_(batch),
   texture_rect_(),
-  vertex_()
+  vertex_(),
+  world_(),
+  dirty_(true),
+  version_(0)
 { SetTextureRect(texture_rect); }
 
+inline void Quad::SetPosition( float x , float y ) {
+  if(Base::getPosition() != sf::Vector2f(x,y)) {
+    Base::setPosition(x,y);
+    dirty_ = true;
+    ++version_;
+  }
+}
+
+inline void Quad::SetRotation( float rot ) {
+  if(Base::getRotation() != rot) {
+    Base::setRotation(rot);
+    dirty_ = true;
+    ++version_;
+  }
+}
+
+inline void Quad::SetScale( float x , float y ) {
+  if(Base::getScale() != sf::Vector2f(x,y)) {
+    Base::setScale(x,y);
+    dirty_ = true;
+    ++version_;
+  }
+}
+
+inline void Quad::SetAnchor( float x , float y ) {
+  if(Base::getOrigin() != sf::Vector2f(x,y)) {
+    Base::setOrigin(x,y);
+    dirty_ = true;
+    ++version_;
+  }
+}
+
+inline const sf::Vertex* Quad::GetWorldVertex() const {
+  if(dirty_) {
+    TransformQuad(QuadTransform(Base::getTransform()),vertex_,world_);
+    dirty_ = false;
+  }
+  return world_;
+}
+
+inline sf::FloatRect Quad::GetWorldBounds() const {
+  auto v = GetWorldVertex();
+  auto l = v[0].position.x , r = l;
+  auto t = v[0].position.y , b = t;
+  for( std::size_t i = 1 ; i < 4 ; ++i ) {
+    l = std::min(l,v[i].position.x); r = std::max(r,v[i].position.x);
+    t = std::min(t,v[i].position.y); b = std::max(b,v[i].position.y);
+  }
+  return sf::FloatRect(l,t,r-l,b-t);
+}
+
 inline void Quad::GetPosition( float* x , float* y ) const {
   auto r = Base::getPosition();
   *x = r.x; *y = r.y;
@@ -121,14 +353,16 @@ inline void Quad::GetAnchor  ( float* x , float* y ) const {
 }
 
 inline void Quad::SetColor( const sf::Color& col , int index ) {
+  // color is not affected by the transform , update the cache in place
   if(index <0) {
-    vertex_[0].color = col;
-    vertex_[1].color = col;
-    vertex_[2].color = col;
-    vertex_[3].color = col;
+    for( std::size_t i = 0 ; i < 4 ; ++i ) {
+      vertex_[i].color = col;
+      world_ [i].color = col;
+    }
   } else {
     assert( index >= 0 && index < 4 );
     vertex_[index].color = col;
+    world_ [index].color = col;
   }
 }
 
@@ -161,15 +395,15 @@ inline void Quad::SetTextureRect( const sf::IntRect& rect ) {
       vertex_[2].texCoords = sf::Vector2f(right,top);
       vertex_[3].texCoords = sf::Vector2f(right,bot);
     }
+
+    texture_rect_ = rect;
+    dirty_        = true;
+    ++version_;
   }
 }
 
-inline void Quad::Render() {
-  auto trans = Base::getTransform();
-  batch_->Enqueue(vertex_[0],trans);
-  batch_->Enqueue(vertex_[1],trans);
-  batch_->Enqueue(vertex_[2],trans);
-  batch_->Enqueue(vertex_[3],trans);
+inline void Quad::Render() const {
+  batch_->EnqueueQuadVertex(GetWorldVertex());
 }
 
 } // namespace sfe
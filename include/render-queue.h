@@ -0,0 +1,147 @@
+#ifndef RENDER_QUEUE_H_
+#define RENDER_QUEUE_H_
+
+#include "misc.h"
+#include "render-batch.h"
+
+#include <SFML/Graphics.hpp>
+#include <cstdint>
+#include <unordered_map>
+#include <vector>
+
+namespace sfe {
+
+// A frame level render queue. Quads and RenderBatch objects are submitted
+// with a 64 bits sort key , when the queue is flushed all submissions are
+// radix sorted by key and the consecutive runs that share the same render
+// states are merged into one draw call.
+//
+// The sort key layout , from the most significant bits :
+//
+//   | layer 8 | blend mode 8 | shader 12 | texture 12 | depth 24 |
+//
+// Everything above the depth bits is the state key , two submissions with
+// the same state key can be drawn together
+class RenderQueue {
+ public:
+  static const int kDepthBits   = 24;
+  static const int kTextureBits = 12;
+  static const int kShaderBits  = 12;
+  static const int kBlendBits   = 8;
+
+  static inline std::uint64_t MakeKey( std::uint8_t  layer  ,
+                                       std::uint32_t blend  ,
+                                       std::uint32_t shader ,
+                                       std::uint32_t texture,
+                                       std::uint32_t depth  );
+
+  static std::uint64_t GetStateKey( std::uint64_t key ) {
+    return key >> kDepthBits;
+  }
+
+  struct Stats {
+    std::size_t submission;       // How many submissions
+    std::size_t draw_call;        // How many draw calls are issued
+    std::size_t state_change;     // How many blend/shader/texture switches
+    std::size_t vertex;           // How many vertex are drawn
+    Stats(): submission(), draw_call(), state_change(), vertex() {}
+  };
+
+  RenderQueue();
+
+ public:
+  // Map render states into the ids used inside of the sort key , the same
+  // state always gets the same id. NULL shader , NULL texture and
+  // sf::BlendAlpha are id 0
+  std::uint32_t GetBlendModeId( const sf::BlendMode& );
+  std::uint32_t GetShaderId   ( const sf::Shader*  );
+  std::uint32_t GetTextureId  ( const sf::Texture* );
+
+  // Build a sort key with the render states of a RenderBatch
+  std::uint64_t MakeKey( const RenderBatch& , std::uint8_t layer ,
+                                              std::uint32_t depth = 0 );
+
+  // Submit a quad with its world vertex , the render states is the same as
+  // its RenderBatch
+  void Submit( const Quad& quad , std::uint8_t layer , std::uint32_t depth = 0 ) {
+    Submit(quad,MakeKey(*quad.batch(),layer,depth));
+  }
+  void Submit( const Quad& , std::uint64_t key );
+
+  // Submit all pending vertex of a RenderBatch. If the batch is in quad list
+  // mode its vertex are moved into the queue and can be merged with other
+  // submissions , otherwise the batch is rendered on its own at its sorted
+  // position
+  void Submit( RenderBatch* batch , std::uint8_t layer , std::uint32_t depth = 0 ) {
+    Submit(batch,MakeKey(*batch,layer,depth));
+  }
+  void Submit( RenderBatch* , std::uint64_t key );
+
+  // Sort , merge and draw all the submissions , then clear the queue
+  void Flush( sf::RenderTarget* );
+
+  // Drop all the submissions without drawing them
+  void Clear();
+
+  // Statistics of the last Flush
+  const Stats& stats() const { return stats_; }
+
+ private:
+  struct Item {
+    std::uint64_t key;
+    std::uint32_t first;          // first vertex inside of vertex_
+    std::uint32_t count;          // vertex count
+    RenderBatch*  batch;          // non mergeable batch
+  };
+
+  // LSD radix sort of the item indices by key , 8 bits per pass. A pass is
+  // skipped when all items share the same digit
+  void Sort();
+
+  void Draw( sf::RenderTarget* , std::uint64_t state );
+
+  // Count the blend/shader/texture switches against the previous draw call
+  void TrackState( std::uint64_t state );
+
+  sf::RenderStates GetStates( std::uint64_t state ) const;
+
+  std::vector<Item>          item_;
+  std::vector<std::uint32_t> order_;
+  std::vector<std::uint32_t> temp_;
+  std::vector<sf::Vertex>    vertex_;       // submitted vertex
+  std::vector<sf::Vertex>    merge_;        // vertex of the current run
+
+  std::vector<sf::BlendMode>      blend_;
+  std::vector<const sf::Shader*>  shader_;
+  std::vector<const sf::Texture*> texture_;
+  std::unordered_map<const sf::Shader* ,std::uint32_t> shader_id_;
+  std::unordered_map<const sf::Texture*,std::uint32_t> texture_id_;
+
+  std::uint64_t last_state_;
+  bool          has_last_state_;
+  Stats         stats_;
+
+  DISALLOW_COPY_AND_ASSIGN(RenderQueue)
+};
+
+inline std::uint64_t RenderQueue::MakeKey( std::uint8_t  layer  ,
+                                           std::uint32_t blend  ,
+                                           std::uint32_t shader ,
+                                           std::uint32_t texture,
+                                           std::uint32_t depth  ) {
+  assert( blend   < (1u << kBlendBits  ) );
+  assert( shader  < (1u << kShaderBits ) );
+  assert( texture < (1u << kTextureBits) );
+  assert( depth   < (1u << kDepthBits  ) );
+
+  std::uint64_t key = layer;
+  key = (key << kBlendBits  ) | blend;
+  key = (key << kShaderBits ) | shader;
+  key = (key << kTextureBits) | texture;
+  key = (key << kDepthBits  ) | depth;
+  return key;
+}
+
+} // namespace sfe
+
+#endif // RENDER_QUEUE_H_
@@ -1,30 +1,78 @@
 #ifndef RESOURCE_MANAGER_H_
 #define RESOURCE_MANAGER_H_
+#include "atlas-packer.h"
+
 #include <SFML/Graphics.hpp>
 #include <string>
+#include <map>
+#include <memory>
+#include <vector>
+#include <ostream>
+#include <cstdint>
 
 namespace sfe {
 
+// A texture or a sub rectangle of an atlas page , the rect can be used
+// directly with Quad::SetTextureRect
+struct TextureRegion {
+  sf::Texture* texture;
+  sf::IntRect  rect;
+  TextureRegion(): texture(NULL), rect() {}
+};
+
 /**
  * A simple resource manager wrapper , user should use it manage all the
  * in memory resources
+ *
+ * A level is a folder under the resource path. Every image file inside of
+ * it becomes a texture and every .vert/.frag file pair becomes a shader ,
+ * both are named by the file name without extension
  */
 class ResourceManager {
  public:
+  // Max size of an atlas page , it is further limited by the GPU
+  static const int kAtlasPageSize    = 2048;
+  static const int kAtlasPadding     = 1;
+
   ResourceManager( const std::string& path );
 
-  // load a specific level's data into the memory
-  bool LoadLevel ( const std::string& name );
+  // load a specific level's data into the memory. If atlas is true all the
+  // images are packed into as few atlas pages as possible. The pack result
+  // is cached in the .atlas folder of the level , later loads reuse it as
+  // long as the source images are not changed
+  bool LoadLevel ( const std::string& name , bool atlas = false );
 
  public:
+  // Get the texture by name , for a packed image it returns the atlas page
   sf::Texture* GetTexture( const std::string& ) const;
   sf::Shader * GetShader ( const std::string& ) const;
 
+  // Get the texture plus the sub rectangle of the image
+  bool GetTextureRegion( const std::string& , TextureRegion* ) const;
+
+  std::size_t atlas_page_size() const { return atlas_page_.size(); }
+
   // dump the loaded resource
   void Dump( std::ostream* ) const;
  private:
+  struct Image {
+    std::string name;
+    std::string file;
+  };
+
+  bool LoadAtlas     ( const std::string& dir , const std::vector<Image>& );
+  bool LoadAtlasCache( const std::string& dir , std::uint64_t signature ,
+                       const std::vector<Image>& );
+  bool SaveAtlasCache( const std::string& dir , std::uint64_t signature ,
+                       const std::vector<sf::Image>&  page  ,
+                       const std::vector<Image>&      image ,
+                       const std::vector<AtlasEntry>& entry ) const;
+
+  std::string path_;
   std::map<std::string,std::unique_ptr<sf::Texture>> texture_;
   std::map<std::string,std::unique_ptr<sf::Shader>>  shader_;
+  std::map<std::string,TextureRegion>                region_;
+  std::vector<std::unique_ptr<sf::Texture>>          atlas_page_;
 };
 
 } // namespace sfe
@@ -0,0 +1,102 @@
+#ifndef SPATIAL_GRID_H_
+#define SPATIAL_GRID_H_
+
+#include "misc.h"
+#include "render-batch.h"
+
+#include <SFML/Graphics.hpp>
+#include <cstdint>
+#include <unordered_map>
+#include <vector>
+
+namespace sfe {
+
+// A uniform grid over the world bounds of Quad objects , used to cull the
+// off-screen quads before they reach RenderBatch. Only the occupied cells
+// are stored , so the world can be arbitrarily large. A quad that spans
+// several cells is stored in each of them and the query removes duplicates.
+//
+// The grid tracks Quad::version , Refresh re-bins only the quads that have
+// been changed since last time and a quad that moves within its cells costs
+// nothing but the bounds update
+class SpatialGrid {
+ public:
+  typedef std::uint32_t Handle;
+
+  SpatialGrid( float cell_size );
+
+  float       cell_size() const { return cell_size_; }
+  std::size_t size     () const { return entry_.size() - free_.size(); }
+
+ public:
+  // Add a quad into the grid , the quad must outlive the grid or be removed
+  Handle Insert( const Quad* );
+  void   Remove( Handle );
+
+  // Re-bin a single quad if it has been changed
+  void   Update( Handle );
+
+  // Re-bin all the quads that have been changed
+  void   Refresh();
+
+  // Get all quads whose bounds intersect with the rectangle , every quad is
+  // reported only once. Output is not cleared
+  void Query( const sf::FloatRect& , std::vector<const Quad*>* output ) const;
+
+  // Get the world space rectangle that is covered by a view
+  static sf::FloatRect GetViewRect( const sf::View& );
+
+  // Query the grid with the view rectangle and render only the visible quads
+  // into their RenderBatch , returns how many quads are rendered. The quads
+  // are rendered in the order they were inserted , so overlapping quads keep
+  // their painter's order regardless of the cell they live in
+  std::size_t Render( const sf::View& );
+
+ private:
+  struct CellRange {
+    int x0 , y0 , x1 , y1;
+    bool operator == ( const CellRange& r ) const {
+      return x0 == r.x0 && y0 == r.y0 && x1 == r.x1 && y1 == r.y1;
+    }
+  };
+
+  struct Entry {
+    const Quad*   quad;
+    sf::FloatRect bounds;
+    CellRange     cell;
+    std::uint32_t version;
+    std::uint64_t order;                   // insertion sequence
+  };
+
+  static std::uint64_t CellKey( int x , int y ) {
+    return (static_cast<std::uint64_t>(static_cast<std::uint32_t>(x)) << 32) |
+            static_cast<std::uint64_t>(static_cast<std::uint32_t>(y));
+  }
+
+  CellRange GetCellRange( const sf::FloatRect& ) const;
+
+  // Call visitor with the handle of every quad intersecting the rectangle
+  template< typename T >
+  void Visit( const sf::FloatRect& , const T& visitor ) const;
+
+  void AddToCell     ( Handle , const CellRange& );
+  void RemoveFromCell( Handle , const CellRange& );
+
+  float cell_size_;
+  std::unordered_map<std::uint64_t,std::vector<Handle>> cell_;
+  std::vector<Entry>  entry_;
+  std::vector<Handle> free_;
+  std::uint64_t       order_;
+
+  // query removes the duplicated quads by stamping the visited entry
+  mutable std::vector<std::uint32_t> mark_;
+  mutable std::uint32_t stamp_;
+
+  std::vector<Handle> visible_;
+
+  DISALLOW_COPY_AND_ASSIGN(SpatialGrid)
+};
+
+} // namespace sfe
+
+#endif // SPATIAL_GRID_H_
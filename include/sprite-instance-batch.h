@@ -0,0 +1,121 @@
+#ifndef SPRITE_INSTANCE_BATCH_H_
+#define SPRITE_INSTANCE_BATCH_H_
+
+#include "misc.h"
+#include "render-batch.h"
+
+#include <SFML/Graphics.hpp>
+#include <cstdint>
+#include <vector>
+
+namespace sfe {
+
+// Packed per sprite record for instanced rendering. It is 32 bytes , 4
+// sf::Vertex of a Quad are 80 bytes. The vertex shader expands it into the
+// 4 corners with the same math as sf::Transformable :
+//
+//   corner = position + rotate(scale * (local - anchor))
+//
+// The anchor keeps 1/16 pixel , so the center of an odd sized rect is exact ,
+// within +-2048 pixels
+struct SpriteInstance {
+  float         x , y;                    // position
+  float         rotation;                 // degree
+  std::int16_t  scale_x , scale_y;        // 8.8 fixed point
+  std::int16_t  anchor_x , anchor_y;      // 12.4 fixed point pixels
+  std::uint16_t tex_left , tex_top;       // texture rect in pixels
+  std::uint16_t tex_width , tex_height;
+  sf::Color     color;
+
+  static inline SpriteInstance Make( float x , float y , float rotation ,
+                                     float scale_x , float scale_y ,
+                                     float anchor_x , float anchor_y ,
+                                     const sf::IntRect& texture_rect ,
+                                     const sf::Color& color );
+};
+
+static_assert( sizeof(SpriteInstance) == 32 , "SpriteInstance must be packed" );
+
+// Draw sprites with hardware instancing , each sprite uploads only one
+// SpriteInstance and no transform is done on CPU. It requires GL 3.3 or the
+// ARB_instanced_arrays/ARB_draw_instanced extensions , which is supported by
+// Mesa llvmpipe. When instancing is not available the sprites are expanded
+// on CPU and drawn through a quad list RenderBatch instead
+class SpriteInstanceBatch {
+ public:
+  SpriteInstanceBatch( sf::BlendMode bm , const sf::Texture* texture = NULL );
+  ~SpriteInstanceBatch();
+
+  const sf::BlendMode& blend_mode() const { return blend_mode_; }
+  const sf::Texture*   texture()    const { return texture_;    }
+
+  std::size_t instance_count() const { return instance_.size(); }
+
+  // Whether instancing is supported by the context , it is only known after
+  // the first Render
+  bool instanced() const { return state_ == AVAILABLE; }
+
+  // Force the CPU fallback path , mainly for testing and benchmarking
+  void set_force_fallback( bool force ) { force_fallback_ = force; }
+
+ public:
+  void Reserve( std::size_t count ) { instance_.reserve(count); }
+
+  void Enqueue( const SpriteInstance& instance ) {
+    instance_.push_back(instance);
+  }
+
+  // Draw all the enqueued sprites and clear the queue
+  void Render( sf::RenderTarget* );
+
+ private:
+  enum State { UNKNOWN , AVAILABLE , UNAVAILABLE };
+
+  // Compile the shader and create buffers , requires an active context
+  bool Init();
+  void RenderInstanced( sf::RenderTarget* , const sf::RenderStates& );
+  void RenderFallback ( sf::RenderTarget* );
+
+  std::vector<SpriteInstance> instance_;
+  sf::BlendMode      blend_mode_;
+  const sf::Texture* texture_;
+  RenderBatch        fallback_;
+  std::vector<QuadTransform> fallback_trans_;
+  std::vector<sf::Vertex>    fallback_corner_;
+  State              state_;
+  bool               force_fallback_;
+  bool               core_;              // GL 3.3 entry points or ARB ones
+
+  unsigned    program_;
+  unsigned    corner_buffer_;
+  unsigned    instance_buffer_;
+  std::size_t instance_capacity_;
+  int         has_texture_loc_;
+
+  DISALLOW_COPY_AND_ASSIGN(SpriteInstanceBatch)
+};
+
+inline SpriteInstance SpriteInstance::Make( float x , float y , float rotation ,
+                                            float scale_x , float scale_y ,
+                                            float anchor_x , float anchor_y ,
+                                            const sf::IntRect& texture_rect ,
+                                            const sf::Color& color ) {
+  SpriteInstance i;
+  i.x          = x;
+  i.y          = y;
+  i.rotation   = rotation;
+  i.scale_x    = static_cast<std::int16_t>(std::lround(scale_x * 256.0f));
+  i.scale_y    = static_cast<std::int16_t>(std::lround(scale_y * 256.0f));
+  i.anchor_x   = static_cast<std::int16_t>(std::lround(anchor_x * 16.0f));
+  i.anchor_y   = static_cast<std::int16_t>(std::lround(anchor_y * 16.0f));
+  i.tex_left   = static_cast<std::uint16_t>(texture_rect.left);
+  i.tex_top    = static_cast<std::uint16_t>(texture_rect.top);
+  i.tex_width  = static_cast<std::uint16_t>(texture_rect.width);
+  i.tex_height = static_cast<std::uint16_t>(texture_rect.height);
+  i.color      = color;
+  return i;
+}
+
+} // namespace sfe
+
+#endif // SPRITE_INSTANCE_BATCH_H_
@@ -0,0 +1,70 @@
+#ifndef STATIC_RENDER_BATCH_H_
+#define STATIC_RENDER_BATCH_H_
+
+#include "misc.h"
+#include "render-batch.h"
+
+#include <SFML/Graphics.hpp>
+#include <algorithm>
+#include <vector>
+
+namespace sfe {
+
+// A retained render batch for geometry that doesn't move , eg: background ,
+// UI frame and decoration. It is built once from a set of Quads and stays
+// uploaded in a static GPU buffer , every Render call is a single indexed
+// draw call until the batch is rebuilt or invalidated. A range of quads can
+// be updated without touching the rest of the buffer
+class StaticRenderBatch {
+ public:
+  StaticRenderBatch( sf::BlendMode bm , const sf::Texture* texture = NULL ,
+                                        const sf::Shader*  shader  = NULL );
+
+  const sf::BlendMode& blend_mode() const { return blend_mode_; }
+  const sf::Texture*   texture()    const { return texture_;    }
+  const sf::Shader*    shader ()    const { return shader_;     }
+
+  std::size_t quad_count() const { return vertex_.size() / 4; }
+  bool        valid     () const { return valid_; }
+
+ public:
+  // Build the batch from the world vertex of the quads , the quads are not
+  // referenced afterwards. Any previous content is replaced
+  void Build ( const Quad* const* quad , std::size_t count );
+
+  // Replace the quads in range [first,first+count) , only that range is
+  // uploaded on the next Render
+  void Update( std::size_t first , const Quad* const* quad , std::size_t count );
+
+  // Drop the content , Render draws nothing until Build is called again
+  void Invalidate();
+
+  // Draw the whole batch with one draw call
+  void Render( sf::RenderTarget* );
+
+ private:
+  // Upload the dirty range into the GPU buffer , returns false if vertex
+  // buffer is not available
+  bool Upload();
+
+  void MarkDirty( std::size_t begin , std::size_t end ) {
+    dirty_begin_ = std::min(dirty_begin_,begin);
+    dirty_end_   = std::max(dirty_end_  ,end  );
+  }
+
+  std::vector<sf::Vertex> vertex_;       // CPU copy of the buffer
+  sf::VertexBuffer   buffer_;
+  std::size_t        buffer_size_;       // vertex count of buffer_
+  std::size_t        dirty_begin_;       // dirty vertex range
+  std::size_t        dirty_end_;
+  sf::BlendMode      blend_mode_;
+  const sf::Texture* texture_;
+  const sf::Shader*  shader_;
+  bool               valid_;
+
+  DISALLOW_COPY_AND_ASSIGN(StaticRenderBatch)
+};
+
+} // namespace sfe
+
+#endif // STATIC_RENDER_BATCH_H_
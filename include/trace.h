@@ -0,0 +1,114 @@
+#ifndef TRACE_H_
+#define TRACE_H_
+
+#include "misc.h"
+
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <vector>
+
+// Timeline recorder that exports Chrome trace event JSON , the output can be
+// opened in chrome://tracing or https://ui.perfetto.dev
+//
+// Tracing is compiled out unless SFE_ENABLE_TRACE is defined (make TRACE=1) ,
+// the SFE_TRACE_* macros expand to nothing otherwise. Every thread records
+// into its own buffer , so recording an event never takes a lock.
+
+namespace sfe   {
+namespace trace {
+
+class Recorder {
+ public:
+  // Maximum events kept per thread , later events are dropped
+  static const std::size_t kMaxEventPerThread = 1 << 20;
+
+  static Recorder& GetInstance();
+
+  // The name must be a string literal or outlive the Recorder , only the
+  // pointer is stored
+  void Begin( const char* name ) { Record(name,'B'); }
+  void End  ( const char* name ) { Record(name,'E'); }
+
+  // Name the calling thread in the timeline
+  void SetThreadName( const char* name );
+
+  // Write all the recorded events into file as Chrome trace JSON. The other
+  // threads must not be recording while flushing
+  bool Flush( const char* file ) const;
+
+  // Flush into the file named by environment variable SFE_TRACE_FILE , or
+  // sfe-trace.json if it is not set
+  bool Flush() const;
+
+  // Drop all the recorded events , same requirement as Flush
+  void Clear();
+
+ private:
+  struct Event {
+    const char*   name;
+    std::uint64_t timestamp;    // nanosecond since the Recorder is created
+    char          phase;        // 'B' or 'E'
+  };
+
+  struct ThreadBuffer {
+    std::vector<Event> event;
+    std::string        name;
+    std::uint32_t      id;
+    std::size_t        dropped;
+  };
+
+  Recorder();
+
+  void Record( const char* , char phase );
+  ThreadBuffer* GetThreadBuffer();
+  std::uint64_t Now() const;
+
+  std::vector<std::unique_ptr<ThreadBuffer>> buffer_;
+  mutable std::mutex lock_;
+  std::uint64_t      epoch_;
+
+  DISALLOW_COPY_AND_ASSIGN(Recorder)
+};
+
+// Record a begin/end pair around a C++ scope
+class Scope {
+ public:
+  explicit Scope( const char* name ) : name_(name) {
+    Recorder::GetInstance().Begin(name);
+  }
+  ~Scope() { Recorder::GetInstance().End(name_); }
+
+ private:
+  const char* name_;
+
+  DISALLOW_COPY_AND_ASSIGN(Scope)
+};
+
+} // namespace trace
+} // namespace sfe
+
+#ifdef SFE_ENABLE_TRACE
+
+#define SFE_TRACE_CONCAT_(A,B) A##B
+#define SFE_TRACE_CONCAT(A,B)  SFE_TRACE_CONCAT_(A,B)
+
+#define SFE_TRACE_SCOPE(NAME) \
+  ::sfe::trace::Scope SFE_TRACE_CONCAT(trace_scope_,__LINE__)(NAME)
+
+#define SFE_TRACE_THREAD(NAME) \
+  ::sfe::trace::Recorder::GetInstance().SetThreadName(NAME)
+
+#define SFE_TRACE_FLUSH() \
+  ::sfe::trace::Recorder::GetInstance().Flush()
+
+#else
+
+#define SFE_TRACE_SCOPE(NAME)  ((void)0)
+#define SFE_TRACE_THREAD(NAME) ((void)0)
+#define SFE_TRACE_FLUSH()      ((void)0)
+
+#endif // SFE_ENABLE_TRACE
+
+#endif // TRACE_H_
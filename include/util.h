@@ -3,6 +3,8 @@
 #include <SFML/Graphics.hpp>
 #include <cstdarg>
 
+#include "adt.h"
+
 namespace sfe {
 namespace util {
 
@@ -38,6 +40,12 @@ inline const char* AsBuffer( const std::string& output ,
 // information
 bool ParseBlendMode( const char* , sf::BlendMode* );
 
+// Parse a gradient , a list of time:value stops separated by ';' with time
+// in [0,1]. A color value is r,g,b,a in [0,255] and a float value must not
+// be negative , ie "0:255,255,255,255;0.5:255,128,0,255;1:64,64,64,0"
+bool ParseGradient( const char* , ColorGradient* );
+bool ParseGradient( const char* , FloatGradient* );
+
 } // namespace util
 } // namespace sfe
 
@@ -0,0 +1,61 @@
+#ifndef VERTEX_STREAM_H_
+#define VERTEX_STREAM_H_
+
+#include "misc.h"
+
+#include <SFML/Graphics.hpp>
+#include <cstdint>
+
+namespace sfe {
+
+// A GPU resident vertex buffer used as a streaming ring. Each Upload places
+// the new vertex right after the previous upload so the driver never needs
+// to wait for the GPU to finish with a range that may still be in flight.
+// When the ring is full the whole storage is orphaned and we restart from
+// the beginning. The capacity is kept across frames and only grows
+class VertexStream {
+ public:
+  static const std::size_t kDefaultCapacity = 4096;
+
+  VertexStream( sf::PrimitiveType type ,
+                std::size_t capacity = kDefaultCapacity );
+
+  // Whether the underlying GL implementation supports vertex buffer objects.
+  // When it returns false user should stick with client side vertex array
+  static bool IsAvailable() { return sf::VertexBuffer::isAvailable(); }
+
+  std::size_t capacity    () const { return capacity_;     }
+  std::size_t orphan_count() const { return orphan_count_; }
+  std::uint64_t upload_bytes() const { return upload_bytes_; }
+
+  // The underlying buffer , used for drawing with raw GL , eg: indexed draw
+  const sf::VertexBuffer& buffer() const { return buffer_; }
+
+ public:
+  // Upload vertex into the ring , the first vertex's index inside of the
+  // buffer is stored into offset. Returns false if the buffer cannot be
+  // created or updated , in this case nothing is uploaded
+  bool Upload( const sf::Vertex* , std::size_t count , std::size_t* offset );
+
+  // Draw a range that was returned by Upload
+  void Draw  ( sf::RenderTarget* , std::size_t offset , std::size_t count ,
+                                   const sf::RenderStates& ) const;
+
+ private:
+  // Orphan the current storage and make sure it can hold at least count
+  // vertex , the capacity is rounded up to power of 2
+  bool Orphan( std::size_t count );
+
+  sf::VertexBuffer buffer_;
+  std::size_t      capacity_;
+  std::size_t      head_;
+  std::size_t      orphan_count_;
+  std::uint64_t    upload_bytes_;
+  bool             created_;
+
+  DISALLOW_COPY_AND_ASSIGN(VertexStream)
+};
+
+} // namespace sfe
+
+#endif // VERTEX_STREAM_H_
@@ -1,6 +1,16 @@
 #include "app.h"
+#include "frame-profiler.h"
+#include "job-system.h"
+#include "trace.h"
+#include "misc.h"
+#include "render-queue.h"
 
 #include <GL/gl.h>
+#include <cmath>
+#include <condition_variable>
+#include <mutex>
+#include <thread>
+#include <vector>
 #include <iostream>
 #include <cstdio>
 #include <SFML/System.h>
@@ -9,8 +19,24 @@ namespace sfe {
 
 App::App( const std::string& title , std::uint32_t fps ):
   window_(),
+  texture_(),
   fps_   (fps),
-  clear_color_() {
+  clear_color_(),
+  profiler_overlay_(false),
+  profiler_csv_(),
+  fixed_rate_(0),
+  max_simulate_step_(kDefaultMaxSimulateStep),
+  accumulator_(0.0),
+  render_alpha_(0.0f),
+  pipelined_(false),
+  pacer_(fps),
+  max_frame_(0),
+  deterministic_(false),
+  throttle_(true),
+  frame_index_(0),
+  script_(),
+  quit_(false),
+  frame_clock_() {
   {
     auto m = sf::VideoMode::getFullscreenModes();
     if(m.empty()) {
@@ -24,11 +50,54 @@ App::App( const std::string& title , std::uint32_t fps ):
 App::App( const std::string& title , std::uint32_t fps , std::size_t width ,
                                                          std::size_t height ):
   window_(),
+  texture_(),
   fps_   (fps),
-  clear_color_() {
+  clear_color_(),
+  profiler_overlay_(false),
+  profiler_csv_(),
+  fixed_rate_(0),
+  max_simulate_step_(kDefaultMaxSimulateStep),
+  accumulator_(0.0),
+  render_alpha_(0.0f),
+  pipelined_(false),
+  pacer_(fps),
+  max_frame_(0),
+  deterministic_(false),
+  throttle_(true),
+  frame_index_(0),
+  script_(),
+  quit_(false),
+  frame_clock_() {
   window_.reset( new sf::RenderWindow(sf::VideoMode(width,height), title.c_str()) );
 }
 
+App::App( std::uint32_t fps , const Headless& headless ):
+  window_(),
+  texture_(),
+  fps_   (fps),
+  clear_color_(),
+  profiler_overlay_(false),
+  profiler_csv_(),
+  fixed_rate_(0),
+  max_simulate_step_(kDefaultMaxSimulateStep),
+  accumulator_(0.0),
+  render_alpha_(0.0f),
+  pipelined_(false),
+  pacer_(fps),
+  max_frame_(headless.frame),
+  deterministic_(headless.deterministic),
+  throttle_(headless.throttle),
+  frame_index_(0),
+  script_(),
+  quit_(false),
+  frame_clock_() {
+  if(headless.width && headless.height) {
+    texture_.reset( new sf::RenderTexture() );
+    fatal_if(texture_->create(headless.width,headless.height),
+             "cannot create render texture %zux%zu",headless.width,headless.height);
+  }
+}
+
 bool App::HandleEvent( const sf::Event& event ) {
   if(event.type == sf::Event::Closed) {
     return true;
@@ -36,55 +105,340 @@ bool App::HandleEvent( const sf::Event& event ) {
   return false;
 }
 
-bool App::Start() {
-  window_->setFramerateLimit(0);
-  window_->setVerticalSyncEnabled(false);
+void App::set_fixed_timestep( std::uint32_t rate , std::uint32_t max_step ) {
+  fatal_if(max_step > 0,"invalid max simulate step:%u",max_step);
+  fixed_rate_        = rate;
+  max_simulate_step_ = max_step;
+}
 
-  if(!HandleInit()) return false;
- 
-  {
-    sf::Clock clock;
-    float prev  = 1.0f / fps_; // guess the first frame's time to be 1.0f / fps_
+float App::Simulate( float delta ) {
+  const double step = 1.0 / fixed_rate_;
+  accumulator_ += delta;
+
+  std::uint32_t count = 0;
+  while(accumulator_ >= step && count < max_simulate_step_) {
+    HandleSimulate(static_cast<float>(step));
+    accumulator_ -= step;
+    ++count;
+  }
+
+  // spiral of death , the simulation cannot keep up so the time that is
+  // left over is dropped instead of being carried into the next frame
+  if(accumulator_ >= step) {
+    accumulator_ = std::fmod(accumulator_,step);
+  }
+
+  return static_cast<float>(accumulator_ / step);
+}
+
+float App::Sleep() {
+  // sleep if needed to maintain stable frame rate
+  ProfileScope scope(FrameProfiler::SCOPE_SLEEP);
+  SFE_TRACE_SCOPE("sleep");
+  auto delta = throttle_ ? pacer_.Wait() : frame_clock_.restart().asSeconds();
+  return deterministic_ ? 1.0f / fps_ : delta;
+}
+
+float App::GetStepDelta( sf::Clock* clock ) {
+  auto delta = clock->restart().asSeconds();
+  return deterministic_ ? 1.0f / fps_ : delta;
+}
+
+bool App::IsRunning() const {
+  if(quit_.load()) return false;
+  if(window_) return window_->isOpen();
+  return max_frame_ == 0 || frame_index_ < max_frame_;
+}
+
+bool App::PollEvent( sf::Event* event ) {
+  if(window_ && window_->pollEvent(*event)) return true;
+
+  // scripted events of this frame
+  auto itr = script_.begin();
+  if(itr != script_.end() && itr->first <= frame_index_) {
+    *event = itr->second;
+    script_.erase(itr);
+    return true;
+  }
+  return false;
+}
+
+void App::Clear() {
+  if(auto t = target()) t->clear(clear_color_);
+}
 
-    while(window_->isOpen()) {
-      sf::Event event;
+void App::Display() {
+  if(window_)
+    window_->display();
+  else if(texture_)
+    texture_->display();
+}
 
-      // restart the timer here
-      clock.restart();
+void App::Run() {
+  sf::Clock step_clock;      // wall time between frames for fixed timestep
+  float prev  = 1.0f / fps_; // guess the first frame's time to be 1.0f / fps_
+  accumulator_ = 0.0;
+  pacer_.Reset();
+  auto& profiler = FrameProfiler::GetInstance();
 
-      while(window_->pollEvent(event)) {
-        if(HandleEvent(event)) {
-          window_->close(); break;
+  while(IsRunning()) {
+    sf::Event event;
+
+    {
+      ProfileScope frame(FrameProfiler::SCOPE_FRAME);
+      SFE_TRACE_SCOPE("frame");
+
+      {
+        ProfileScope scope(FrameProfiler::SCOPE_EVENT);
+        SFE_TRACE_SCOPE("event");
+        while(PollEvent(&event)) {
+          if(HandleEvent(event)) {
+            Quit(); break;
+          }
         }
       }
 
+      // run the fixed simulation steps for the time elapsed since the
+      // last frame
+      if(fixed_rate_) {
+        ProfileScope scope(FrameProfiler::SCOPE_SIMULATE);
+        SFE_TRACE_SCOPE("App::HandleSimulate");
+        render_alpha_ = Simulate(GetStepDelta(&step_clock));
+      }
 
       // call the callback function
       {
-        window_->clear(clear_color_);
+        {
+          ProfileScope scope(FrameProfiler::SCOPE_CLEAR);
+          SFE_TRACE_SCOPE("clear");
+          Clear();
+        }
+
+        if(fixed_rate_) {
+          ProfileScope scope(FrameProfiler::SCOPE_UPDATE);
+          SFE_TRACE_SCOPE("App::HandleRender");
+          HandleRender( render_alpha_ , target() );
+        } else {
+          ProfileScope scope(FrameProfiler::SCOPE_UPDATE);
+          SFE_TRACE_SCOPE("App::HandleUpdate");
+          HandleUpdate( prev , target() );
+        }
 
-        HandleUpdate( prev , window_.get() );
+        if(profiler_overlay_ && target()) {
+          profiler.DrawOverlay(target(),sf::Vector2f(8.0f,8.0f));
+        }
 
-        window_->display();
+        {
+          ProfileScope scope(FrameProfiler::SCOPE_DISPLAY);
+          SFE_TRACE_SCOPE("display");
+          Display();
+        }
       }
 
       // get frame check point
-      auto seconds = clock.getElapsedTime().asSeconds();
-      prev = seconds;
-
-      { // sleep if needed to maintain stable frame rate
-        auto left   = (1.0f/fps_) - seconds;
-        if(left >0) {
-          sf::sleep(sf::seconds(left));
-          prev = 1.0f / fps_;
-        } else {
-          prev = seconds;
+      prev = Sleep();
+    }
+
+    profiler.EndFrame();
+    ++frame_index_;
+  }
+}
+
+void App::RunPipelined() {
+  // Two command lists , the worker records frame N+1 into one of them while
+  // the main thread flushes frame N from the other. The events of a frame
+  // are polled on the main thread , which owns the window , and handed to
+  // the worker with the slot so every user callback runs on the worker
+  struct Slot {
+    RenderQueue queue;
+    std::vector<sf::Event> event;
+    float delta;
+  };
+
+  Slot slot[2];
+  std::mutex lock;
+  std::condition_variable cond;
+  int  kick  = -1;      // slot the worker needs to record
+  bool done  = false;   // worker finished the kicked slot
+  bool quit  = false;
+  bool close = false;   // HandleEvent asked to close the window
+
+  std::thread worker([&]() {
+    SFE_TRACE_THREAD("simulation");
+    sf::Clock step_clock;
+
+    for( ;; ) {
+      int index;
+      {
+        std::unique_lock<std::mutex> l(lock);
+        cond.wait(l,[&]() { return kick >= 0 || quit; });
+        if(kick < 0) return;
+        index = kick;
+        kick  = -1;
+      }
+
+      auto& s = slot[index];
+      bool  c = false;
+      {
+        SFE_TRACE_SCOPE("event");
+        for( auto& e : s.event ) {
+          if(HandleEvent(e)) { c = true; break; }
         }
+        s.event.clear();
+      }
+
+      if(fixed_rate_) {
+        ProfileScope scope(FrameProfiler::SCOPE_SIMULATE);
+        SFE_TRACE_SCOPE("App::HandleSimulate");
+        render_alpha_ = Simulate(GetStepDelta(&step_clock));
+      }
+
+      {
+        ProfileScope scope(FrameProfiler::SCOPE_UPDATE);
+        SFE_TRACE_SCOPE("App::HandleRecord");
+        HandleRecord( s.delta , &s.queue );
+      }
+
+      {
+        std::lock_guard<std::mutex> l(lock);
+        done  = true;
+        close = close || c;
+      }
+      cond.notify_all();
+    }
+  });
+
+  auto Kick = [&]( int index ) {
+    {
+      std::lock_guard<std::mutex> l(lock);
+      kick = index;
+      done = false;
+    }
+    cond.notify_all();
+  };
+
+  // returns true if the window needs to be closed
+  auto Wait = [&]() {
+    std::unique_lock<std::mutex> l(lock);
+    cond.wait(l,[&]() { return done; });
+    return close;
+  };
+
+  auto Poll = [&]( std::vector<sf::Event>* output ) {
+    ProfileScope scope(FrameProfiler::SCOPE_EVENT);
+    SFE_TRACE_SCOPE("event");
+    sf::Event event;
+    while(PollEvent(&event)) output->push_back(event);
+  };
+
+  float prev  = 1.0f / fps_;
+  int record  = 0;
+  accumulator_ = 0.0;
+  pacer_.Reset();
+  auto& profiler = FrameProfiler::GetInstance();
+  const int wait_scope = profiler.RegisterScope("wait");
+
+  // prime the pipeline with the first frame
+  Poll(&slot[record].event);
+  slot[record].delta = prev;
+  Kick(record);
+
+  while(IsRunning()) {
+    {
+      ProfileScope frame(FrameProfiler::SCOPE_FRAME);
+      SFE_TRACE_SCOPE("frame");
+
+      bool c;
+      {
+        ProfileScope scope(wait_scope);
+        SFE_TRACE_SCOPE("wait");
+        c = Wait();
+      }
+      if(c) {
+        Quit(); break;
+      }
+
+      // start recording the next frame , then submit the finished one
+      auto submit = record;
+      record = 1 - record;
+      Poll(&slot[record].event);
+      slot[record].delta = prev;
+      Kick(record);
+
+      {
+        ProfileScope scope(FrameProfiler::SCOPE_CLEAR);
+        SFE_TRACE_SCOPE("clear");
+        Clear();
+      }
+
+      {
+        SFE_TRACE_SCOPE("RenderQueue::Flush");
+        if(target())
+          slot[submit].queue.Flush(target());
+        else
+          slot[submit].queue.Clear();
+      }
+
+      if(profiler_overlay_ && target()) {
+        profiler.DrawOverlay(target(),sf::Vector2f(8.0f,8.0f));
+      }
+
+      {
+        ProfileScope scope(FrameProfiler::SCOPE_DISPLAY);
+        SFE_TRACE_SCOPE("display");
+        Display();
       }
+
+      prev = Sleep();
     }
-  } 
+
+    profiler.EndFrame();
+    ++frame_index_;
+  }
+
+  Wait();
+  {
+    std::lock_guard<std::mutex> l(lock);
+    quit = true;
+  }
+  cond.notify_all();
+  worker.join();
+}
+
+bool App::Start() {
+  if(window_) {
+    window_->setFramerateLimit(0);
+    window_->setVerticalSyncEnabled(false);
+  }
+  quit_.store(false);
+  frame_index_ = 0;
+  frame_clock_.restart();
+
+  SFE_TRACE_THREAD("main");
+
+  // create the shared job system here so the main thread owns its deque ,
+  // not whichever thread happens to use it first
+  JobSystem::GetInstance();
+  {
+    SFE_TRACE_SCOPE("App::HandleInit");
+    if(!HandleInit()) return false;
+  }
+ 
+  if(pipelined_) {
+    RunPipelined();
+  } else {
+    Run();
+  }
+
+  if(!profiler_csv_.empty() &&
+     !FrameProfiler::GetInstance().DumpCSV(profiler_csv_.c_str())) {
+    std::cerr<<"cannot dump profiler to "<<profiler_csv_<<std::endl;
+  }
+
+  if(window_ && window_->isOpen()) window_->close();
 
   HandleClose();
+  SFE_TRACE_FLUSH();
   return true;
 }
 
@@ -0,0 +1,145 @@
+#include "atlas-packer.h"
+
+#include <algorithm>
+#include <limits>
+#include <memory>
+#include <numeric>
+
+namespace sfe {
+
+SkylinePacker::SkylinePacker( int width , int height ):
+  skyline_  (),
+  width_    (width),
+  height_   (height),
+  used_area_(0)
+{ Reset(); }
+
+void SkylinePacker::Reset() {
+  skyline_.clear();
+  Node n = { 0 , 0 , width_ };
+  skyline_.push_back(n);
+  used_area_ = 0;
+}
+
+bool SkylinePacker::Fit( std::size_t index , int width , int height ,
+                                                         int* y ) const {
+  auto x = skyline_[index].x;
+  if(x + width > width_) return false;
+
+  // the rectangle may span several segments , it has to sit on the
+  // highest one of them
+  int top  = skyline_[index].y;
+  int left = width;
+  for( std::size_t i = index ; left > 0 ; ++i ) {
+    if(i == skyline_.size()) return false;
+    top = std::max(top,skyline_[i].y);
+    if(top + height > height_) return false;
+    left -= skyline_[i].width;
+  }
+
+  *y = top;
+  return true;
+}
+
+void SkylinePacker::AddLevel( std::size_t index , const sf::IntRect& rect ) {
+  Node n = { rect.left , rect.top + rect.height , rect.width };
+  skyline_.insert(skyline_.begin() + index , n);
+
+  // shrink or remove the segments covered by the new one
+  for( std::size_t i = index + 1 ; i < skyline_.size() ; ) {
+    auto& prev = skyline_[i-1];
+    auto& cur  = skyline_[i];
+    auto  end  = prev.x + prev.width;
+
+    if(cur.x >= end) break;
+
+    auto shrink = end - cur.x;
+    cur.x     += shrink;
+    cur.width -= shrink;
+    if(cur.width <= 0) {
+      skyline_.erase(skyline_.begin() + i);
+    } else {
+      break;
+    }
+  }
+
+  // merge neighbor segments that have the same height
+  for( std::size_t i = 0 ; i + 1 < skyline_.size() ; ) {
+    if(skyline_[i].y == skyline_[i+1].y) {
+      skyline_[i].width += skyline_[i+1].width;
+      skyline_.erase(skyline_.begin() + i + 1);
+    } else {
+      ++i;
+    }
+  }
+}
+
+bool SkylinePacker::Insert( int width , int height , sf::IntRect* output ) {
+  int best_top   = std::numeric_limits<int>::max();
+  int best_width = std::numeric_limits<int>::max();
+  std::size_t best = skyline_.size();
+  sf::IntRect rect;
+
+  for( std::size_t i = 0 ; i < skyline_.size() ; ++i ) {
+    int y;
+    if(!Fit(i,width,height,&y)) continue;
+
+    auto top = y + height;
+    if(top < best_top || (top == best_top && skyline_[i].width < best_width)) {
+      best_top   = top;
+      best_width = skyline_[i].width;
+      best       = i;
+      rect       = sf::IntRect(skyline_[i].x,y,width,height);
+    }
+  }
+
+  if(best == skyline_.size()) return false;
+
+  AddLevel(best,rect);
+  used_area_ += static_cast<std::int64_t>(width) * height;
+  *output = rect;
+  return true;
+}
+
+int PackAtlas( const std::vector<sf::Vector2i>& size , int page_size ,
+                                                     int padding ,
+                                                     std::vector<AtlasEntry>* output ) {
+  output->assign(size.size(),AtlasEntry{ -1 , sf::IntRect() });
+
+  // place the tallest images first , it gives a much flatter skyline
+  std::vector<std::size_t> order(size.size());
+  std::iota(order.begin(),order.end(),0);
+  std::stable_sort(order.begin(),order.end(),
+      [&size]( std::size_t l , std::size_t r ) {
+        if(size[l].y != size[r].y) return size[l].y > size[r].y;
+        return size[l].x > size[r].x;
+      });
+
+  std::vector<std::unique_ptr<SkylinePacker>> page;
+
+  for( auto idx : order ) {
+    auto w = size[idx].x + padding * 2;
+    auto h = size[idx].y + padding * 2;
+    if(w > page_size || h > page_size) continue;
+
+    sf::IntRect rect;
+    std::size_t p = 0;
+    for( ; p < page.size() ; ++p ) {
+      if(page[p]->Insert(w,h,&rect)) break;
+    }
+
+    if(p == page.size()) {
+      page.emplace_back(new SkylinePacker(page_size,page_size));
+      page.back()->Insert(w,h,&rect);
+    }
+
+    auto& e = (*output)[idx];
+    e.page = static_cast<int>(p);
+    e.rect = sf::IntRect(rect.left + padding , rect.top + padding ,
+                         size[idx].x , size[idx].y);
+  }
+
+  return static_cast<int>(page.size());
+}
+
+} // namespace sfe
@@ -0,0 +1,108 @@
+#include "frame-pacer.h"
+
+#include <algorithm>
+#include <cstring>
+#include <thread>
+
+namespace sfe {
+namespace {
+
+// Initial and bound of the spin margin
+const std::chrono::microseconds kDefaultSpin(1500);
+const std::chrono::microseconds kMinSpin    (200);
+const std::chrono::microseconds kMaxSpin    (4000);
+
+} // namespace
+
+const int FramePacer::kBucketBound[] = {
+  25 , 50 , 100 , 250 , 500 , 1000 , 2000
+};
+
+const std::size_t FramePacer::kBucketSize;
+
+FramePacer::FramePacer( std::uint32_t fps ):
+  fps_        (),
+  period_     (),
+  spin_       (kDefaultSpin),
+  last_       (Clock::now()),
+  spin_enable_(true),
+  stats_      ()
+{ set_fps(fps); }
+
+void FramePacer::set_fps( std::uint32_t fps ) {
+  fps_    = fps;
+  period_ = std::chrono::duration_cast<Clock::duration>(
+      std::chrono::duration<double>(1.0 / fps));
+}
+
+void FramePacer::Reset() {
+  last_ = Clock::now();
+}
+
+void FramePacer::ResetStats() {
+  std::memset(&stats_,0,sizeof(stats_));
+}
+
+float FramePacer::Wait() {
+  auto deadline = last_ + period_;
+  auto now      = Clock::now();
+
+  if(now < deadline) {
+    auto margin = spin_enable_ ? spin_ : Clock::duration::zero();
+    auto coarse = deadline - margin;
+
+    if(now < coarse) {
+      std::this_thread::sleep_until(coarse);
+      now = Clock::now();
+
+      // adapt the margin to the oversleep , grow fast and shrink slowly
+      if(spin_enable_) {
+        auto over = now - coarse;
+        spin_ = std::max(over + over / 4 , spin_ - spin_ / 64);
+        spin_ = std::min<Clock::duration>(std::max<Clock::duration>(spin_,kMinSpin),
+                                          kMaxSpin);
+      }
+    }
+
+    while(now < deadline) {
+      std::this_thread::yield();
+      now = Clock::now();
+    }
+
+    Record(std::chrono::duration<double,std::micro>(now - deadline).count());
+  } else {
+    ++stats_.overrun;
+  }
+
+  auto delta = now - last_;
+  last_ = now;
+  return std::chrono::duration<float>(delta).count();
+}
+
+void FramePacer::Record( double jitter ) {
+  std::size_t bucket = 0;
+  while(bucket < kBucketSize - 1 && jitter >= kBucketBound[bucket]) ++bucket;
+  ++stats_.histogram[bucket];
+
+  ++stats_.frame;
+  stats_.max_jitter   = std::max(stats_.max_jitter,jitter);
+  stats_.mean_jitter += (jitter - stats_.mean_jitter) / stats_.frame;
+}
+
+void FramePacer::Dump( std::ostream* output ) const {
+  *output << "frame pacer " << fps_ << " fps , frame:" << stats_.frame
+          << " overrun:" << stats_.overrun
+          << " mean jitter:" << stats_.mean_jitter << "us"
+          << " max jitter:"  << stats_.max_jitter  << "us"
+          << " spin margin:" << spin_margin()      << "us\n";
+
+  for( std::size_t i = 0 ; i < kBucketSize ; ++i ) {
+    if(i < kBucketSize - 1)
+      *output << "  < " << kBucketBound[i] << "us";
+    else
+      *output << "  >= " << kBucketBound[i-1] << "us";
+    *output << " : " << stats_.histogram[i] << "\n";
+  }
+}
+
+} // namespace sfe
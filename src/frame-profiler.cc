@@ -0,0 +1,210 @@
+#include "frame-profiler.h"
+
+#include <algorithm>
+#include <cstdio>
+#include <vector>
+
+namespace sfe {
+namespace {
+
+const char* kBuiltinScopeName[] = {
+  "frame" , "event" , "update" , "clear" , "display" , "sleep" , "simulate"
+};
+
+// Color of the builtin phases in the overlay , frame is the total and is
+// not drawn as a bar segment
+const sf::Color kPhaseColor[] = {
+  sf::Color(255,255,255),
+  sf::Color(230,200, 60),
+  sf::Color( 80,200, 80),
+  sf::Color( 80,140,230),
+  sf::Color(220, 80, 80),
+  sf::Color(110,110,110),
+  sf::Color(200,100,220)
+};
+
+const float kBarWidth        = 2.0f;
+const float kPixelPerMS      = 4.0f;
+const unsigned kTextSize     = 12;
+
+void AddRect( sf::VertexArray* output , float x , float y , float w , float h ,
+                                        const sf::Color& color ) {
+  output->append(sf::Vertex(sf::Vector2f(x  ,y  ),color));
+  output->append(sf::Vertex(sf::Vector2f(x+w,y  ),color));
+  output->append(sf::Vertex(sf::Vector2f(x+w,y+h),color));
+  output->append(sf::Vertex(sf::Vector2f(x  ,y+h),color));
+}
+
+} // namespace
+
+const std::size_t FrameProfiler::kMaxScope;
+const std::size_t FrameProfiler::kFrameSize;
+
+FrameProfiler& FrameProfiler::GetInstance() {
+  static FrameProfiler kInstance;
+  return kInstance;
+}
+
+FrameProfiler::FrameProfiler():
+  accumulator_(),
+  frame_      (),
+  head_       (0),
+  name_       (),
+  scope_count_(0),
+  name_lock_  (),
+  font_       (NULL),
+  enable_     (true)
+{
+  for( auto& e : accumulator_ ) e.store(0,std::memory_order_relaxed);
+  for( int i = 0 ; i < SIZE_OF_BUILTIN_SCOPE ; ++i )
+    name_[i] = kBuiltinScopeName[i];
+  scope_count_.store(SIZE_OF_BUILTIN_SCOPE,std::memory_order_release);
+}
+
+int FrameProfiler::RegisterScope( const char* name ) {
+  std::lock_guard<std::mutex> lock(name_lock_);
+  auto count = scope_count_.load(std::memory_order_relaxed);
+
+  for( std::size_t i = 0 ; i < count ; ++i ) {
+    if(name_[i] == name) return static_cast<int>(i);
+  }
+
+  if(count == kMaxScope) return -1;
+
+  name_[count] = name;
+  scope_count_.store(count+1,std::memory_order_release);
+  return static_cast<int>(count);
+}
+
+void FrameProfiler::EndFrame() {
+  auto head  = head_.load(std::memory_order_relaxed);
+  auto* slot = frame_[head % kFrameSize];
+
+  for( std::size_t i = 0 ; i < kMaxScope ; ++i )
+    slot[i] = accumulator_[i].exchange(0,std::memory_order_relaxed);
+
+  head_.store(head+1,std::memory_order_release);
+}
+
+void FrameProfiler::Reset() {
+  for( auto& e : accumulator_ ) e.store(0,std::memory_order_relaxed);
+  head_.store(0,std::memory_order_release);
+}
+
+std::size_t FrameProfiler::GetHistory( int scope , double* output ) const {
+  auto head  = head_.load(std::memory_order_acquire);
+  auto size  = std::min(head,kFrameSize);
+  auto start = head - size;
+
+  for( std::size_t i = 0 ; i < size ; ++i )
+    output[i] = frame_[(start + i) % kFrameSize][scope] / 1000000.0;
+  return size;
+}
+
+bool FrameProfiler::GetStats( int scope , Stats* stats ) const {
+  if(scope < 0 || static_cast<std::size_t>(scope) >= scope_count())
+    return false;
+
+  double history[kFrameSize];
+  auto size = GetHistory(scope,history);
+  if(size == 0) return false;
+
+  double sum = 0.0;
+  for( std::size_t i = 0 ; i < size ; ++i ) sum += history[i];
+
+  stats->avg = sum / size;
+  stats->min = *std::min_element(history,history+size);
+  stats->max = *std::max_element(history,history+size);
+
+  // nearest rank percentile
+  auto rank = (size * 99 + 99) / 100 - 1;
+  std::nth_element(history,history+rank,history+size);
+  stats->p99 = history[rank];
+  return true;
+}
+
+void FrameProfiler::DrawOverlay( sf::RenderTarget* target ,
+                                 const sf::Vector2f& position ) const {
+  double history[SIZE_OF_BUILTIN_SCOPE][kFrameSize];
+  std::size_t size = 0;
+  for( int i = 0 ; i < SIZE_OF_BUILTIN_SCOPE ; ++i )
+    size = GetHistory(i,history[i]);
+
+  auto view = target->getView();
+  target->setView(target->getDefaultView());
+
+  // background , tall enough for 2 frames at 60 fps
+  const float height = 2.0f * 1000.0f / 60.0f * kPixelPerMS;
+  sf::VertexArray graph(sf::Quads);
+  AddRect(&graph,position.x,position.y,kFrameSize * kBarWidth,height,
+          sf::Color(0,0,0,160));
+
+  const float bottom = position.y + height;
+  for( std::size_t f = 0 ; f < size ; ++f ) {
+    float x = position.x + f * kBarWidth;
+    float y = bottom;
+    for( int i = SCOPE_EVENT ; i < SIZE_OF_BUILTIN_SCOPE ; ++i ) {
+      float h = std::min(static_cast<float>(history[i][f]) * kPixelPerMS ,
+                         y - position.y);
+      if(h <= 0.0f) continue;
+      y -= h;
+      AddRect(&graph,x,y,kBarWidth,h,kPhaseColor[i]);
+    }
+  }
+
+  // 60 fps budget line
+  AddRect(&graph,position.x,bottom - 1000.0f / 60.0f * kPixelPerMS,
+          kFrameSize * kBarWidth,1.0f,sf::Color::White);
+  target->draw(graph);
+
+  if(font_) {
+    float y = bottom + 2.0f;
+    for( std::size_t i = 0 ; i < scope_count() ; ++i ) {
+      Stats stats;
+      if(!GetStats(static_cast<int>(i),&stats)) continue;
+
+      char buffer[128];
+      std::snprintf(buffer,sizeof(buffer),
+                    "%-10s min %6.2f avg %6.2f p99 %6.2f ms",
+                    name_[i].c_str(),stats.min,stats.avg,stats.p99);
+
+      sf::Text text(buffer,*font_,kTextSize);
+      text.setPosition(position.x,y);
+      text.setFillColor(i < SIZE_OF_BUILTIN_SCOPE ? kPhaseColor[i] :
+                                                    sf::Color::White);
+      target->draw(text);
+      y += kTextSize + 2.0f;
+    }
+  }
+
+  target->setView(view);
+}
+
+bool FrameProfiler::DumpCSV( const char* file ) const {
+  FILE* output = std::fopen(file,"w");
+  if(!output) return false;
+
+  auto count = scope_count();
+  std::vector<std::vector<double>> history(count,
+                                           std::vector<double>(kFrameSize));
+  std::size_t size = 0;
+  for( std::size_t i = 0 ; i < count ; ++i )
+    size = GetHistory(static_cast<int>(i),history[i].data());
+
+  std::fprintf(output,"frame");
+  for( std::size_t i = 0 ; i < count ; ++i )
+    std::fprintf(output,",%s_ms",name_[i].c_str());
+  std::fprintf(output,"\n");
+
+  auto first = frame_count() - size;
+  for( std::size_t f = 0 ; f < size ; ++f ) {
+    std::fprintf(output,"%zu",first + f);
+    for( std::size_t i = 0 ; i < count ; ++i )
+      std::fprintf(output,",%.4f",history[i][f]);
+    std::fprintf(output,"\n");
+  }
+
+  return std::fclose(output) == 0;
+}
+
+} // namespace sfe
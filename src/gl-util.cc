@@ -0,0 +1,184 @@
+#include "gl-util.h"
+
+#ifndef GL_GLEXT_PROTOTYPES
+#define GL_GLEXT_PROTOTYPES
+#endif // GL_GLEXT_PROTOTYPES
+#include <GL/gl.h>
+#include <GL/glext.h>
+
+#include <cassert>
+#include <cstddef>
+#include <cstdio>
+#include <cstring>
+#include <limits>
+
+namespace sfe {
+namespace gl {
+namespace {
+
+GLenum MapFactor( sf::BlendMode::Factor factor ) {
+  switch(factor) {
+    case sf::BlendMode::Zero:             return GL_ZERO;
+    case sf::BlendMode::One:              return GL_ONE;
+    case sf::BlendMode::SrcColor:         return GL_SRC_COLOR;
+    case sf::BlendMode::OneMinusSrcColor: return GL_ONE_MINUS_SRC_COLOR;
+    case sf::BlendMode::DstColor:         return GL_DST_COLOR;
+    case sf::BlendMode::OneMinusDstColor: return GL_ONE_MINUS_DST_COLOR;
+    case sf::BlendMode::SrcAlpha:         return GL_SRC_ALPHA;
+    case sf::BlendMode::OneMinusSrcAlpha: return GL_ONE_MINUS_SRC_ALPHA;
+    case sf::BlendMode::DstAlpha:         return GL_DST_ALPHA;
+    case sf::BlendMode::OneMinusDstAlpha: return GL_ONE_MINUS_DST_ALPHA;
+    default: assert(false); return GL_ZERO;
+  }
+}
+
+GLenum MapEquation( sf::BlendMode::Equation equation ) {
+  return equation == sf::BlendMode::Add ? GL_FUNC_ADD : GL_FUNC_SUBTRACT;
+}
+
+// Point the fixed function vertex attributes into an array of sf::Vertex ,
+// base is either a client pointer or an offset into the bound buffer
+void SetVertexPointer( const char* base ) {
+  glVertexPointer  (2,GL_FLOAT        ,sizeof(sf::Vertex),
+                    base + offsetof(sf::Vertex,position ));
+  glColorPointer   (4,GL_UNSIGNED_BYTE,sizeof(sf::Vertex),
+                    base + offsetof(sf::Vertex,color    ));
+  glTexCoordPointer(2,GL_FLOAT        ,sizeof(sf::Vertex),
+                    base + offsetof(sf::Vertex,texCoords));
+}
+
+void DrawElements( std::size_t quads ) {
+  auto& ib = QuadIndexBuffer::GetInstance();
+  if(!ib.Reserve(quads)) return;
+
+  glDrawElements(GL_TRIANGLES,static_cast<GLsizei>(quads * 6),
+                 GL_UNSIGNED_INT,ib.Bind());
+  ib.Unbind();
+}
+
+} // namespace
+
+void BeginDraw( sf::RenderTarget* target , const sf::RenderStates& states ) {
+  // resetGLStates activates the target and enables the client states , but
+  // SFML only applies the view lazily inside of its own draw call. Apply the
+  // viewport and the projection of the current view here , the same way
+  // sf::RenderTarget does
+  target->resetGLStates();
+
+  const auto& view = target->getView();
+  auto vp = target->getViewport(view);
+  glViewport(vp.left,static_cast<GLint>(target->getSize().y) - (vp.top + vp.height),
+             vp.width,vp.height);
+  glMatrixMode(GL_PROJECTION);
+  glLoadMatrixf(view.getTransform().getMatrix());
+
+  const auto& bm = states.blendMode;
+  glBlendFuncSeparate(MapFactor(bm.colorSrcFactor),MapFactor(bm.colorDstFactor),
+                      MapFactor(bm.alphaSrcFactor),MapFactor(bm.alphaDstFactor));
+  glBlendEquationSeparate(MapEquation(bm.colorEquation),
+                          MapEquation(bm.alphaEquation));
+
+  glMatrixMode(GL_MODELVIEW);
+  glLoadMatrixf(states.transform.getMatrix());
+
+  // texture coordinate is in pixels as what sf::Vertex uses
+  sf::Texture::bind(states.texture,sf::Texture::Pixels);
+  sf::Shader ::bind(states.shader);
+}
+
+void EndDraw( sf::RenderTarget* target ) {
+  sf::Shader::bind(NULL);
+  sf::VertexBuffer::bind(NULL);
+
+  // SFML caches the GL states , we changed them behind its back
+  target->resetGLStates();
+}
+
+bool IsVersionAtLeast( int major , int minor ) {
+  auto version = reinterpret_cast<const char*>(glGetString(GL_VERSION));
+  int ma , mi;
+  if(!version || std::sscanf(version,"%d.%d",&ma,&mi) != 2) return false;
+  return ma > major || (ma == major && mi >= minor);
+}
+
+bool HasExtension( const char* name ) {
+  auto ext = reinterpret_cast<const char*>(glGetString(GL_EXTENSIONS));
+  if(!ext) return false;
+
+  auto len = std::strlen(name);
+  for( auto p = std::strstr(ext,name) ; p ; p = std::strstr(p+len,name) ) {
+    if((p == ext || p[-1] == ' ') && (p[len] == ' ' || p[len] == 0))
+      return true;
+  }
+  return false;
+}
+
+QuadIndexBuffer& QuadIndexBuffer::GetInstance() {
+  static QuadIndexBuffer kInstance;
+  return kInstance;
+}
+
+bool QuadIndexBuffer::Reserve( std::size_t quads ) {
+  if(quads <= capacity_) return true;
+  if(quads > std::numeric_limits<std::uint32_t>::max() / 4) return false;
+
+  auto cap = capacity_ ? capacity_ : 1024;
+  while(cap < quads) cap *= 2;
+
+  index_.resize(cap * 6);
+  for( std::size_t i = capacity_ ; i < cap ; ++i ) {
+    auto v = static_cast<std::uint32_t>(i * 4);
+    auto p = index_.data() + i * 6;
+    p[0] = v;   p[1] = v+1; p[2] = v+2;
+    p[3] = v+2; p[4] = v+1; p[5] = v+3;
+  }
+  capacity_ = cap;
+
+  if(sf::VertexBuffer::isAvailable()) {
+    if(!buffer_) glGenBuffers(1,&buffer_);
+    glBindBuffer(GL_ELEMENT_ARRAY_BUFFER,buffer_);
+    glBufferData(GL_ELEMENT_ARRAY_BUFFER,index_.size() * sizeof(std::uint32_t),
+                                         index_.data(),GL_STATIC_DRAW);
+    glBindBuffer(GL_ELEMENT_ARRAY_BUFFER,0);
+  }
+  return true;
+}
+
+const void* QuadIndexBuffer::Bind() const {
+  if(buffer_) {
+    glBindBuffer(GL_ELEMENT_ARRAY_BUFFER,buffer_);
+    return NULL;
+  }
+  return index_.data();
+}
+
+void QuadIndexBuffer::Unbind() const {
+  if(buffer_) glBindBuffer(GL_ELEMENT_ARRAY_BUFFER,0);
+}
+
+void DrawQuadList( sf::RenderTarget* target , const sf::RenderStates& states ,
+                                              const sf::Vertex* vertex ,
+                                              std::size_t quads ) {
+  if(!quads) return;
+
+  BeginDraw(target,states);
+  SetVertexPointer(reinterpret_cast<const char*>(vertex));
+  DrawElements(quads);
+  EndDraw(target);
+}
+
+void DrawQuadList( sf::RenderTarget* target , const sf::RenderStates& states ,
+                                              const sf::VertexBuffer& buffer ,
+                                              std::size_t first ,
+                                              std::size_t quads ) {
+  if(!quads) return;
+
+  BeginDraw(target,states);
+  sf::VertexBuffer::bind(&buffer);
+  SetVertexPointer(static_cast<const char*>(NULL) + first * sizeof(sf::Vertex));
+  DrawElements(quads);
+  EndDraw(target);
+}
+
+} // namespace gl
+} // namespace sfe
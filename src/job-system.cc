@@ -0,0 +1,243 @@
+#include "job-system.h"
+
+#include <algorithm>
+
+namespace sfe {
+namespace {
+
+// The deques owned by the current thread , one per JobSystem. A system is
+// keyed by a unique id rather than its address , so the entry of a system
+// destroyed on another thread can never match a later system
+struct LocalDeque {
+  std::uint64_t id;
+  std::size_t   index;
+};
+
+thread_local std::vector<LocalDeque> kLocal;
+std::atomic<std::uint64_t>           kNextId(1);
+
+void BindLocal( std::uint64_t id , std::size_t index ) {
+  kLocal.push_back(LocalDeque{ id , index });
+}
+
+void UnbindLocal( std::uint64_t id ) {
+  kLocal.erase(std::remove_if(kLocal.begin(),kLocal.end(),
+      [id]( const LocalDeque& e ) { return e.id == id; }),kLocal.end());
+}
+
+// How many times an idle worker looks for a job before going to sleep
+const int kIdleSpin = 64;
+
+} // namespace
+
+const std::size_t JobSystem::kJobDataSize;
+const std::size_t JobSystem::kQueueSize;
+
+bool JobSystem::WorkDeque::Push( Job* job ) {
+  auto b = bottom_.load(std::memory_order_relaxed);
+  auto t = top_.load(std::memory_order_acquire);
+  if(b - t >= static_cast<std::int64_t>(kQueueSize)) return false;
+
+  buffer_[b & (kQueueSize - 1)].store(job,std::memory_order_relaxed);
+  bottom_.store(b + 1,std::memory_order_release);
+  return true;
+}
+
+JobSystem::Job* JobSystem::WorkDeque::Pop() {
+  auto b = bottom_.load(std::memory_order_relaxed) - 1;
+  bottom_.store(b,std::memory_order_relaxed);
+  std::atomic_thread_fence(std::memory_order_seq_cst);
+  auto t = top_.load(std::memory_order_relaxed);
+
+  if(t > b) {
+    // empty
+    bottom_.store(b + 1,std::memory_order_relaxed);
+    return NULL;
+  }
+
+  Job* job = buffer_[b & (kQueueSize - 1)].load(std::memory_order_relaxed);
+  if(t == b) {
+    // last job , race with the thieves
+    if(!top_.compare_exchange_strong(t,t + 1,std::memory_order_seq_cst,
+                                             std::memory_order_relaxed))
+      job = NULL;
+    bottom_.store(b + 1,std::memory_order_relaxed);
+  }
+  return job;
+}
+
+JobSystem::Job* JobSystem::WorkDeque::Steal() {
+  auto t = top_.load(std::memory_order_acquire);
+  std::atomic_thread_fence(std::memory_order_seq_cst);
+  auto b = bottom_.load(std::memory_order_acquire);
+  if(t >= b) return NULL;
+
+  Job* job = buffer_[t & (kQueueSize - 1)].load(std::memory_order_relaxed);
+  if(!top_.compare_exchange_strong(t,t + 1,std::memory_order_seq_cst,
+                                           std::memory_order_relaxed))
+    return NULL;
+  return job;
+}
+
+JobSystem::Job* JobSystem::WorkDeque::Allocate() {
+  auto job = &pool_[next_ & (kQueueSize - 1)];
+  if(job->busy.load(std::memory_order_acquire)) return NULL;
+  ++next_;
+  job->busy.store(true,std::memory_order_relaxed);
+  job->heap = false;
+  return job;
+}
+
+JobSystem& JobSystem::GetInstance() {
+  static JobSystem kInstance(std::max(1u,std::thread::hardware_concurrency()) - 1);
+  return kInstance;
+}
+
+JobSystem::JobSystem( std::size_t worker ):
+  id_         (kNextId.fetch_add(1)),
+  deque_      (),
+  worker_     (),
+  shared_lock_(),
+  shared_     (),
+  pending_    (0),
+  sleeping_   (0),
+  sleep_lock_ (),
+  sleep_cond_ (),
+  quit_       (false)
+{
+  for( std::size_t i = 0 ; i <= worker ; ++i )
+    deque_.emplace_back(new WorkDeque());
+
+  BindLocal(id_,0);
+
+  for( std::size_t i = 1 ; i <= worker ; ++i )
+    worker_.emplace_back(&JobSystem::WorkerMain,this,i);
+}
+
+JobSystem::~JobSystem() {
+  {
+    std::lock_guard<std::mutex> lock(sleep_lock_);
+    quit_.store(true);
+  }
+  sleep_cond_.notify_all();
+  for( auto& e : worker_ ) e.join();
+
+  UnbindLocal(id_);
+}
+
+std::size_t JobSystem::GetLocalIndex() const {
+  for( auto& e : kLocal ) {
+    if(e.id == id_) return e.index;
+  }
+  return deque_.size();
+}
+
+JobSystem::WorkDeque* JobSystem::GetLocalDeque() const {
+  auto index = GetLocalIndex();
+  return index < deque_.size() ? deque_[index].get() : NULL;
+}
+
+JobSystem::Job* JobSystem::Allocate( WorkDeque* local ) {
+  if(local) return local->Allocate();
+
+  auto job  = new Job();
+  job->heap = true;
+  return job;
+}
+
+void JobSystem::Submit( WorkDeque* local , Job* job ) {
+  if(local) {
+    if(!local->Push(job)) {
+      // deque is full
+      Execute(job);
+      return;
+    }
+  } else {
+    std::lock_guard<std::mutex> lock(shared_lock_);
+    shared_.push_back(job);
+  }
+
+  pending_.fetch_add(1);
+  if(sleeping_.load() > 0) {
+    std::lock_guard<std::mutex> lock(sleep_lock_);
+    sleep_cond_.notify_one();
+  }
+}
+
+JobSystem::Job* JobSystem::FindJob( WorkDeque* local ) {
+  Job* job = local ? local->Pop() : NULL;
+
+  if(!job) {
+    std::unique_lock<std::mutex> lock(shared_lock_,std::try_to_lock);
+    if(lock.owns_lock() && !shared_.empty()) {
+      job = shared_.front();
+      shared_.pop_front();
+    }
+  }
+
+  if(!job) {
+    // start stealing from a different victim on each thread
+    auto n     = deque_.size();
+    auto start = local ? GetLocalIndex() + 1 : 0;
+    for( std::size_t i = 0 ; i < n && !job ; ++i ) {
+      auto victim = deque_[(start + i) % n].get();
+      if(victim != local) job = victim->Steal();
+    }
+  }
+
+  if(job) pending_.fetch_sub(1,std::memory_order_relaxed);
+  return job;
+}
+
+void JobSystem::Execute( Job* job ) {
+  auto counter = job->counter;
+  job->invoke(job);
+
+  if(job->heap)
+    delete job;
+  else
+    job->busy.store(false,std::memory_order_release);
+
+  if(counter) counter->count_.fetch_sub(1,std::memory_order_release);
+}
+
+void JobSystem::Wait( JobCounter* counter ) {
+  auto local = GetLocalDeque();
+  while(counter->count_.load(std::memory_order_acquire) > 0) {
+    if(auto job = FindJob(local))
+      Execute(job);
+    else
+      std::this_thread::yield();
+  }
+}
+
+void JobSystem::WorkerMain( std::size_t index ) {
+  BindLocal(id_,index);
+  auto local = deque_[index].get();
+  int idle   = 0;
+
+  while(!quit_.load(std::memory_order_relaxed)) {
+    if(auto job = FindJob(local)) {
+      Execute(job);
+      idle = 0;
+      continue;
+    }
+
+    if(++idle < kIdleSpin) {
+      std::this_thread::yield();
+      continue;
+    }
+
+    // nothing to do , sleep until a job is submitted
+    std::unique_lock<std::mutex> lock(sleep_lock_);
+    sleeping_.fetch_add(1);
+    sleep_cond_.wait(lock,[this]() {
+      return pending_.load() > 0 || quit_.load();
+    });
+    sleeping_.fetch_sub(1);
+    idle = 0;
+  }
+  UnbindLocal(id_);
+}
+
+} // namespace sfe
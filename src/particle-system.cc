@@ -0,0 +1,700 @@
+#include "particle-system.h"
+#include "job-system.h"
+#include "random.h"
+#include "trace.h"
+#include "util.h"
+
+#include <algorithm>
+#include <atomic>
+#include <cassert>
+#include <cmath>
+
+#if defined(__AVX__)
+#include <immintrin.h>
+#elif defined(__SSE2__)
+#include <emmintrin.h>
+#endif
+
+namespace sfe {
+namespace detail {
+namespace {
+
+const float kPi = 3.14159265358979f;
+
+// The update kernel is written once against the small vector interface
+// below and instantiated for scalar , SSE and AVX. A Mask holds the per
+// lane result of a comparison
+
+struct ScalarLane {
+  typedef float Vec;
+  typedef bool  Mask;
+  static const std::size_t kWidth = 1;
+
+  static Vec  Load ( const float* p ) { return *p; }
+  static void Store( float* p , Vec v ) { *p = v; }
+  static Vec  Set  ( float v ) { return v; }
+  static Vec  Add  ( Vec a , Vec b ) { return a + b; }
+  static Vec  Sub  ( Vec a , Vec b ) { return a - b; }
+  static Vec  Mul  ( Vec a , Vec b ) { return a * b; }
+  static Vec  Div  ( Vec a , Vec b ) { return a / b; }
+  static Vec  Sqrt ( Vec a ) { return std::sqrt(a); }
+  static Vec  Min  ( Vec a , Vec b ) { return std::min(a,b); }
+  static Vec  Max  ( Vec a , Vec b ) { return std::max(a,b); }
+  static Vec  Round( Vec a ) { return std::nearbyint(a); }
+  static Mask GreaterEqual( Vec a , Vec b ) { return a >= b; }
+  static Mask Greater     ( Vec a , Vec b ) { return a >  b; }
+  static Mask And   ( Mask a , Mask b ) { return a && b; }
+  static Mask AndNot( Mask a , Mask b ) { return !a && b; }
+  static Mask Xor   ( Mask a , Mask b ) { return a != b; }
+  static Vec  Select( Mask m , Vec a , Vec b ) { return m ? a : b; }
+  static bool Any   ( Mask m ) { return m; }
+  static std::size_t Count( Mask m ) { return m ? 1 : 0; }
+};
+
+#if defined(__SSE2__)
+struct SSELane {
+  typedef __m128 Vec;
+  typedef __m128 Mask;
+  static const std::size_t kWidth = 4;
+
+  static Vec  Load ( const float* p ) { return _mm_load_ps(p); }
+  static void Store( float* p , Vec v ) { _mm_store_ps(p,v); }
+  static Vec  Set  ( float v ) { return _mm_set1_ps(v); }
+  static Vec  Add  ( Vec a , Vec b ) { return _mm_add_ps(a,b); }
+  static Vec  Sub  ( Vec a , Vec b ) { return _mm_sub_ps(a,b); }
+  static Vec  Mul  ( Vec a , Vec b ) { return _mm_mul_ps(a,b); }
+  static Vec  Div  ( Vec a , Vec b ) { return _mm_div_ps(a,b); }
+  static Vec  Sqrt ( Vec a ) { return _mm_sqrt_ps(a); }
+  static Vec  Min  ( Vec a , Vec b ) { return _mm_min_ps(a,b); }
+  static Vec  Max  ( Vec a , Vec b ) { return _mm_max_ps(a,b); }
+  static Vec  Round( Vec a ) { return _mm_cvtepi32_ps(_mm_cvtps_epi32(a)); }
+  static Mask GreaterEqual( Vec a , Vec b ) { return _mm_cmpge_ps(a,b); }
+  static Mask Greater     ( Vec a , Vec b ) { return _mm_cmpgt_ps(a,b); }
+  static Mask And   ( Mask a , Mask b ) { return _mm_and_ps(a,b); }
+  static Mask AndNot( Mask a , Mask b ) { return _mm_andnot_ps(a,b); }
+  static Mask Xor   ( Mask a , Mask b ) { return _mm_xor_ps(a,b); }
+  static Vec  Select( Mask m , Vec a , Vec b ) {
+    return _mm_or_ps(_mm_and_ps(m,a),_mm_andnot_ps(m,b));
+  }
+  static bool Any   ( Mask m ) { return _mm_movemask_ps(m) != 0; }
+  static std::size_t Count( Mask m ) {
+    return __builtin_popcount(_mm_movemask_ps(m));
+  }
+};
+#endif // __SSE2__
+
+#if defined(__AVX__)
+struct AVXLane {
+  typedef __m256 Vec;
+  typedef __m256 Mask;
+  static const std::size_t kWidth = 8;
+
+  static Vec  Load ( const float* p ) { return _mm256_load_ps(p); }
+  static void Store( float* p , Vec v ) { _mm256_store_ps(p,v); }
+  static Vec  Set  ( float v ) { return _mm256_set1_ps(v); }
+  static Vec  Add  ( Vec a , Vec b ) { return _mm256_add_ps(a,b); }
+  static Vec  Sub  ( Vec a , Vec b ) { return _mm256_sub_ps(a,b); }
+  static Vec  Mul  ( Vec a , Vec b ) { return _mm256_mul_ps(a,b); }
+  static Vec  Div  ( Vec a , Vec b ) { return _mm256_div_ps(a,b); }
+  static Vec  Sqrt ( Vec a ) { return _mm256_sqrt_ps(a); }
+  static Vec  Min  ( Vec a , Vec b ) { return _mm256_min_ps(a,b); }
+  static Vec  Max  ( Vec a , Vec b ) { return _mm256_max_ps(a,b); }
+  static Vec  Round( Vec a ) {
+    return _mm256_round_ps(a,_MM_FROUND_TO_NEAREST_INT | _MM_FROUND_NO_EXC);
+  }
+  static Mask GreaterEqual( Vec a , Vec b ) {
+    return _mm256_cmp_ps(a,b,_CMP_GE_OQ);
+  }
+  static Mask Greater( Vec a , Vec b ) {
+    return _mm256_cmp_ps(a,b,_CMP_GT_OQ);
+  }
+  static Mask And   ( Mask a , Mask b ) { return _mm256_and_ps(a,b); }
+  static Mask AndNot( Mask a , Mask b ) { return _mm256_andnot_ps(a,b); }
+  static Mask Xor   ( Mask a , Mask b ) { return _mm256_xor_ps(a,b); }
+  static Vec  Select( Mask m , Vec a , Vec b ) {
+    return _mm256_blendv_ps(b,a,m);
+  }
+  static bool Any   ( Mask m ) { return _mm256_movemask_ps(m) != 0; }
+  static std::size_t Count( Mask m ) {
+    return __builtin_popcount(_mm256_movemask_ps(m));
+  }
+};
+#endif // __AVX__
+
+// Raw pointer of every field , so the kernel doesn't go through the buffer
+struct FieldPointer {
+  float* field[ParticleBuffer::SIZE_OF_FIELD];
+
+  explicit FieldPointer( ParticleBuffer* buffer ) {
+    for( int i = 0 ; i < ParticleBuffer::SIZE_OF_FIELD ; ++i )
+      field[i] = (*buffer)[static_cast<ParticleBuffer::Field>(i)];
+  }
+
+  float* operator [] ( ParticleBuffer::Field f ) const { return field[f]; }
+};
+
+// new = old + delta * dt , only stored for the lanes in live
+template< typename L >
+inline void Integrate( const FieldPointer& f , std::size_t i ,
+                       ParticleBuffer::Field value ,
+                       ParticleBuffer::Field delta ,
+                       typename L::Vec dt , typename L::Mask live ) {
+  auto v = L::Load(f[value] + i);
+  auto d = L::Load(f[delta] + i);
+  L::Store(f[value] + i,L::Select(live,L::Add(v,L::Mul(d,dt)),v));
+}
+
+// Update kWidth particles starting at i , returns how many of them died.
+// The terms of the features not in F are compiled out
+template< typename L , unsigned F >
+std::size_t UpdateLane( const FieldPointer& f , std::size_t i ,
+                        typename L::Vec origin_x ,
+                        typename L::Vec origin_y ,
+                        typename L::Vec dt ) {
+  typedef ParticleBuffer B;
+  auto zero  = L::Set(0.0f);
+  auto age   = L::Load(f[B::AGE ] + i);
+  auto life  = L::Load(f[B::LIFE] + i);
+  auto alive = L::GreaterEqual(age,zero);
+  auto next  = L::Add(age,dt);
+  auto die   = L::And(alive,L::GreaterEqual(next,life));
+  auto live  = L::AndNot(die,alive);
+
+  L::Store(f[B::AGE] + i,L::Select(die,L::Set(-1.0f),L::Select(alive,next,age)));
+  if(!L::Any(live)) return L::Count(die);
+
+  const bool kRadial     = (F & FEATURE_RADIAL_ACC    ) != 0;
+  const bool kTangential = (F & FEATURE_TANGENTIAL_ACC) != 0;
+  const bool kGravity    = (F & FEATURE_GRAVITY       ) != 0;
+
+  auto px = L::Load(f[B::POSITION_X] + i);
+  auto py = L::Load(f[B::POSITION_Y] + i);
+  auto vx = L::Load(f[B::VELOCITY_X] + i);
+  auto vy = L::Load(f[B::VELOCITY_Y] + i);
+
+  if(kRadial || kTangential) {
+    // unit vector from the emitter to the particle
+    auto dx  = L::Sub(px,origin_x);
+    auto dy  = L::Sub(py,origin_y);
+    auto len = L::Sqrt(L::Add(L::Mul(dx,dx),L::Mul(dy,dy)));
+    auto inv = L::Select(L::Greater(len,zero),L::Div(L::Set(1.0f),len),zero);
+    dx = L::Mul(dx,inv);
+    dy = L::Mul(dy,inv);
+
+    // radial acceleration pushes along (dx,dy) and tangential acceleration
+    // along its perpendicular (-dy,dx)
+    auto ax = zero , ay = zero;
+    if(kRadial) {
+      auto racc = L::Load(f[B::RADIAL_ACC] + i);
+      ax = L::Mul(dx,racc);
+      ay = L::Mul(dy,racc);
+    }
+    if(kTangential) {
+      auto tacc = L::Load(f[B::TANGENTIAL_ACC] + i);
+      ax = L::Sub(ax,L::Mul(dy,tacc));
+      ay = L::Add(ay,L::Mul(dx,tacc));
+    }
+    if(kGravity) ay = L::Add(ay,L::Load(f[B::GRAVITY] + i));
+
+    vx = L::Select(live,L::Add(vx,L::Mul(ax,dt)),vx);
+    vy = L::Select(live,L::Add(vy,L::Mul(ay,dt)),vy);
+    L::Store(f[B::VELOCITY_X] + i,vx);
+    L::Store(f[B::VELOCITY_Y] + i,vy);
+  } else if(kGravity) {
+    auto ay = L::Load(f[B::GRAVITY] + i);
+    vy = L::Select(live,L::Add(vy,L::Mul(ay,dt)),vy);
+    L::Store(f[B::VELOCITY_Y] + i,vy);
+  }
+
+  L::Store(f[B::POSITION_X] + i,L::Select(live,L::Add(px,L::Mul(vx,dt)),px));
+  L::Store(f[B::POSITION_Y] + i,L::Select(live,L::Add(py,L::Mul(vy,dt)),py));
+
+  if(F & FEATURE_SPIN) Integrate<L>(f,i,B::SPIN,B::SPIN_DELTA,dt,live);
+  return L::Count(die);
+}
+
+template< typename L , unsigned F >
+std::size_t UpdateRange( const FieldPointer& f , std::size_t* index ,
+                         std::size_t last ,
+                         float origin_x , float origin_y , float delta ) {
+  auto ox = L::Set(origin_x);
+  auto oy = L::Set(origin_y);
+  auto dt = L::Set(delta);
+
+  std::size_t dead = 0;
+  std::size_t i    = *index;
+  for( ; i + L::kWidth <= last ; i += L::kWidth )
+    dead += UpdateLane<L,F>(f,i,ox,oy,dt);
+  *index = i;
+  return dead;
+}
+
+// The widest lane first and the scalar one for the rest
+template< unsigned F >
+std::size_t UpdateKernel( ParticleBuffer* buffer , std::size_t first ,
+                                                   std::size_t last ,
+                                                   float origin_x ,
+                                                   float origin_y ,
+                                                   float delta ) {
+  assert( first % ParticleBuffer::kLaneSize == 0 );
+  assert( last <= buffer->capacity() );
+  FieldPointer f(buffer);
+  std::size_t dead = 0;
+
+#if defined(__AVX__)
+  dead += UpdateRange<AVXLane,F>(f,&first,last,origin_x,origin_y,delta);
+#elif defined(__SSE2__)
+  dead += UpdateRange<SSELane,F>(f,&first,last,origin_x,origin_y,delta);
+#endif
+  dead += UpdateRange<ScalarLane,F>(f,&first,last,origin_x,origin_y,delta);
+  return dead;
+}
+
+// Indexed by the feature bitmask
+const ParticleKernel kParticleKernel[SIZE_OF_FEATURE_SET] = {
+  &UpdateKernel<0 > , &UpdateKernel<1 > , &UpdateKernel<2 > , &UpdateKernel<3 > ,
+  &UpdateKernel<4 > , &UpdateKernel<5 > , &UpdateKernel<6 > , &UpdateKernel<7 > ,
+  &UpdateKernel<8 > , &UpdateKernel<9 > , &UpdateKernel<10> , &UpdateKernel<11> ,
+  &UpdateKernel<12> , &UpdateKernel<13> , &UpdateKernel<14> , &UpdateKernel<15>
+};
+
+// r,g,b,a of the color as float
+inline void GetChannel( const Color& col , float* output ) {
+  output[0] = col.r; output[1] = col.g; output[2] = col.b; output[3] = col.a;
+}
+
+// Value of the gradient at time t , sorted by time , into the N channels of
+// output. Before the first stop and after the last one the gradient keeps
+// their value
+template< int N , typename T , typename F >
+void SampleGradient( const std::vector<GradientStop<T> >& stops , float t ,
+                     float* output , const F& channel ) {
+  auto next = std::upper_bound(stops.begin(),stops.end(),t,
+      []( float v , const GradientStop<T>& s ) { return v < s.time; });
+  if(next == stops.begin() || next == stops.end()) {
+    channel((next == stops.begin() ? *next : stops.back()).value,output);
+    return;
+  }
+
+  auto prev = next - 1;
+  float a[N] , b[N];
+  channel(prev->value,a);
+  channel(next->value,b);
+  auto span = next->time - prev->time;
+  auto w    = span > 0.0f ? (t - prev->time) / span : 1.0f;
+  for( int k = 0 ; k < N ; ++k ) output[k] = a[k] + (b[k] - a[k]) * w;
+}
+
+// The stops sorted by time , the order of the stops with the same time is
+// kept so the gradient can jump
+template< typename T >
+std::vector<GradientStop<T> > SortStop( std::vector<GradientStop<T> > stops ) {
+  std::stable_sort(stops.begin(),stops.end(),
+      []( const GradientStop<T>& l , const GradientStop<T>& r ) {
+        return l.time < r.time;
+      });
+  return stops;
+}
+
+// Sine and cosine of x , reduced into [-pi/4,pi/4] around the closest
+// multiple k of pi/2 and approximated with the cephes polynomials
+template< typename L >
+inline void SinCos( typename L::Vec x , typename L::Vec* sin ,
+                                        typename L::Vec* cos ) {
+  auto k = L::Round(L::Mul(x,L::Set(0.63661977236758134f)));
+  auto r = L::Sub(x,L::Mul(k,L::Set(1.5703125f)));
+  r = L::Sub(r,L::Mul(k,L::Set(4.837512969970703125e-4f)));
+  r = L::Sub(r,L::Mul(k,L::Set(7.54978995489188216e-8f)));
+
+  auto r2 = L::Mul(r,r);
+  auto sr = L::Set(-1.9515295891e-4f);
+  sr = L::Add(L::Mul(sr,r2),L::Set( 8.3321608736e-3f));
+  sr = L::Add(L::Mul(sr,r2),L::Set(-1.6666654611e-1f));
+  sr = L::Add(L::Mul(L::Mul(sr,r2),r),r);
+
+  auto cr = L::Set(2.443315711809948e-5f);
+  cr = L::Add(L::Mul(cr,r2),L::Set(-1.388731625493765e-3f));
+  cr = L::Add(L::Mul(cr,r2),L::Set( 4.166664568298827e-2f));
+  cr = L::Add(L::Sub(L::Mul(L::Mul(cr,r2),r2),L::Mul(r2,L::Set(0.5f))),
+              L::Set(1.0f));
+
+  // quadrant k mod 4 from the low 2 bits of k , floor(k/2) is computed as
+  // round(k/2 - 1/4) since k is an integer
+  auto half  = L::Set(0.5f);
+  auto zero  = L::Set(0.0f);
+  auto k2    = L::Round(L::Sub(L::Mul(k ,half),L::Set(0.25f)));
+  auto k4    = L::Round(L::Sub(L::Mul(k2,half),L::Set(0.25f)));
+  auto odd   = L::GreaterEqual(L::Sub(k ,L::Add(k2,k2)),half);
+  auto upper = L::GreaterEqual(L::Sub(k2,L::Add(k4,k4)),half);
+
+  auto s = L::Select(odd,cr,sr);
+  auto c = L::Select(odd,sr,cr);
+  *sin = L::Select(upper             ,L::Sub(zero,s),s);
+  *cos = L::Select(L::Xor(upper,odd) ,L::Sub(zero,c),c);
+}
+
+// Write the 4 corners of kWidth particles starting at i into output , the
+// vertex of particle i first
+template< typename L >
+void EmitLane( const FieldPointer& f , std::size_t i , std::size_t count ,
+               const ParticleShape& shape , const ParticleLut& lut ,
+               sf::Vertex* output ) {
+  typedef ParticleBuffer B;
+  enum { INDEX , SCALE , AX , AY , BX , BY , SIZE_OF_VALUE };
+  alignas(32) float value[SIZE_OF_VALUE][L::kWidth];
+
+  // closest lut sample of the normalized age , a dead padding slot has a
+  // negative age and a zero life and samples the first one
+  auto zero  = L::Set(0.0f);
+  auto age   = L::Load(f[B::AGE ] + i);
+  auto life  = L::Load(f[B::LIFE] + i);
+  auto inv   = L::Select(L::Greater(life,zero),L::Div(L::Set(1.0f),life),zero);
+  auto t     = L::Min(L::Max(L::Mul(age,inv),zero),L::Set(1.0f));
+  L::Store(value[INDEX],L::Add(L::Mul(t,L::Set(ParticleLut::kSize - 1.0f)),
+                               L::Set(0.5f)));
+  for( std::size_t k = 0 ; k < L::kWidth ; ++k )
+    value[SCALE][k] = lut.size[static_cast<std::size_t>(value[INDEX][k])];
+
+  typename L::Vec sin , cos;
+  SinCos<L>(L::Load(f[B::SPIN] + i),&sin,&cos);
+
+  // half diagonal of the rotated and scaled quad along its 2 local axes
+  auto size = L::Mul(L::Load(f[B::SIZE] + i),L::Load(value[SCALE]));
+  auto hw   = L::Mul(size,L::Set(shape.half_width ));
+  auto hh   = L::Mul(size,L::Set(shape.half_height));
+
+  L::Store(value[AX],L::Mul(hw,cos));
+  L::Store(value[AY],L::Mul(hw,sin));
+  L::Store(value[BX],L::Sub(zero,L::Mul(hh,sin)));
+  L::Store(value[BY],L::Mul(hh,cos));
+
+  for( std::size_t k = 0 ; k < count ; ++k ) {
+    auto px = f[B::POSITION_X][i + k];
+    auto py = f[B::POSITION_Y][i + k];
+    auto ax = value[AX][k] , ay = value[AY][k];
+    auto bx = value[BX][k] , by = value[BY][k];
+    auto col = lut.color[static_cast<std::size_t>(value[INDEX][k])];
+
+    // same corner order as Quad
+    auto v = output + k * 4;
+    v[0].position = sf::Vector2f(px - ax - bx,py - ay - by);
+    v[1].position = sf::Vector2f(px - ax + bx,py - ay + by);
+    v[2].position = sf::Vector2f(px + ax - bx,py + ay - by);
+    v[3].position = sf::Vector2f(px + ax + bx,py + ay + by);
+    v[0].texCoords = sf::Vector2f(shape.left ,shape.top   );
+    v[1].texCoords = sf::Vector2f(shape.left ,shape.bottom);
+    v[2].texCoords = sf::Vector2f(shape.right,shape.top   );
+    v[3].texCoords = sf::Vector2f(shape.right,shape.bottom);
+    v[0].color = v[1].color = v[2].color = v[3].color = col;
+  }
+}
+
+} // namespace
+
+const std::size_t ParticleBuffer::kLaneSize;
+const std::size_t ParticleBuffer::kAlignment;
+const std::size_t ParticleLut::kSize;
+
+ParticleBuffer::ParticleBuffer( std::size_t capacity ):
+  data_    (),
+  field_   (),
+  capacity_((capacity + kLaneSize - 1) / kLaneSize * kLaneSize),
+  size_    (0)
+{
+  auto stride = std::max(capacity_,kLaneSize);
+  data_.reset(static_cast<float*>(std::aligned_alloc(kAlignment,
+      stride * SIZE_OF_FIELD * sizeof(float))));
+  fatal_if(data_,"cannot allocate %zu particles",capacity_);
+
+  for( int i = 0 ; i < SIZE_OF_FIELD ; ++i ) {
+    field_[i] = data_.get() + stride * i;
+    std::fill(field_[i],field_[i] + stride,0.0f);
+  }
+  std::fill(field_[AGE],field_[AGE] + stride,-1.0f);
+}
+
+void ParticleBuffer::Compact() {
+  auto age = field_[AGE];
+  std::size_t i = 0;
+  while(i < size_) {
+    if(age[i] >= 0.0f) {
+      ++i;
+      continue;
+    }
+    // check slot i again , the moved particle can be dead as well
+    auto last = --size_;
+    if(i != last) Move(last,i);
+    age[last] = -1.0f;
+  }
+}
+
+void ParticleBuffer::Clear() {
+  std::fill(field_[AGE],field_[AGE] + size_,-1.0f);
+  size_ = 0;
+}
+
+std::size_t UpdateParticles( ParticleBuffer* buffer , std::size_t first ,
+                                                      std::size_t last ,
+                                                      float origin_x ,
+                                                      float origin_y ,
+                                                      float delta ) {
+  return UpdateKernel<FEATURE_ALL>(buffer,first,last,origin_x,origin_y,delta);
+}
+
+ParticleKernel GetParticleKernel( unsigned feature ) {
+  assert( feature < SIZE_OF_FEATURE_SET );
+  return kParticleKernel[feature];
+}
+
+std::size_t UpdateParticlesScalar( ParticleBuffer* buffer , std::size_t first ,
+                                                            std::size_t last ,
+                                                            float origin_x ,
+                                                            float origin_y ,
+                                                            float delta ) {
+  assert( last <= buffer->capacity() );
+  FieldPointer f(buffer);
+  return UpdateRange<ScalarLane,FEATURE_ALL>(f,&first,last,origin_x,origin_y,
+                                             delta);
+}
+
+ParticleLut::ParticleLut( const ColorGradient& color_gradient ,
+                          const FloatGradient& size_gradient ) {
+  auto colors = SortStop(color_gradient);
+  auto sizes  = SortStop(size_gradient);
+  if(colors.empty()) colors.push_back(GradientStop<Color>(0.0f,Color(255,255,255,255)));
+  if(sizes .empty()) sizes .push_back(GradientStop<float>(0.0f,1.0f));
+
+  auto size_channel = []( float v , float* output ) { output[0] = v; };
+  for( std::size_t i = 0 ; i < kSize ; ++i ) {
+    auto  t = static_cast<float>(i) / (kSize - 1);
+    float c[4] , s;
+    SampleGradient<4>(colors,t,c ,GetChannel);
+    SampleGradient<1>(sizes ,t,&s,size_channel);
+
+    color[i] = sf::Color(static_cast<std::uint8_t>(c[0] + 0.5f),
+                         static_cast<std::uint8_t>(c[1] + 0.5f),
+                         static_cast<std::uint8_t>(c[2] + 0.5f),
+                         static_cast<std::uint8_t>(c[3] + 0.5f));
+    size [i] = s;
+  }
+}
+
+ParticleShape::ParticleShape( const sf::IntRect& rect ):
+  half_width (rect.width  * 0.5f),
+  half_height(rect.height * 0.5f),
+  left       (static_cast<float>(rect.left)),
+  top        (static_cast<float>(rect.top)),
+  right      (static_cast<float>(rect.left + rect.width)),
+  bottom     (static_cast<float>(rect.top  + rect.height))
+{}
+
+void EmitParticleQuads( ParticleBuffer* buffer , std::size_t first ,
+                                                 std::size_t last ,
+                                                 const ParticleShape& shape ,
+                                                 const ParticleLut& lut ,
+                                                 sf::Vertex* output ) {
+  assert( first % ParticleBuffer::kLaneSize == 0 );
+  assert( last <= buffer->capacity() );
+  FieldPointer f(buffer);
+
+  // the last lane reads the padding slots , which are always allocated
+#if defined(__AVX__)
+  typedef AVXLane Lane;
+#elif defined(__SSE2__)
+  typedef SSELane Lane;
+#else
+  typedef ScalarLane Lane;
+#endif
+  const std::size_t width = Lane::kWidth;
+  for( auto i = first ; i < last ; i += width )
+    EmitLane<Lane>(f,i,std::min(width,last - i),shape,lut,
+                   output + (i - first) * 4);
+}
+
+} // namespace detail
+
+namespace {
+
+// Seed of a system without explicit seed , taken from the thread's stream
+std::uint64_t RandomSeed() {
+  auto& rng = Random::GetInstance();
+  return static_cast<std::uint64_t>(rng.Next()) << 32 | rng.Next();
+}
+
+// A term is needed unless its range is [0,0]
+unsigned GetFeature( const ParticleConfig& config ) {
+  auto used = []( const FloatRange& r ) {
+    return r.lower != 0.0f || r.upper != 0.0f;
+  };
+  unsigned feature = 0;
+  if(used(config.gravity       )) feature |= detail::FEATURE_GRAVITY;
+  if(used(config.radial_acc    )) feature |= detail::FEATURE_RADIAL_ACC;
+  if(used(config.tangential_acc)) feature |= detail::FEATURE_TANGENTIAL_ACC;
+  if(used(config.spin_delta    )) feature |= detail::FEATURE_SPIN;
+  return feature;
+}
+
+} // namespace
+
+const std::size_t ParticleSystem::kParallelChunk;
+const std::size_t ParticleSystem::kDefaultParallelThreshold;
+
+ParticleConfig::ParticleConfig():
+  max_particles  (1000),
+  rate           (100.0f),
+  full_life      (-1.0f),
+  direction      (0.0f),
+  spread         (2.0f * detail::kPi),
+  speed          (),
+  spawn_x        (),
+  spawn_y        (),
+  life           (1.0f,1.0f),
+  gravity        (),
+  radial_acc     (),
+  tangential_acc (),
+  size           (1.0f,1.0f),
+  spin           (),
+  spin_delta     (),
+  color_over_life(),
+  size_over_life (),
+  seed           (0)
+{}
+
+void ParticleConfig::SetColorOverLife( const std::string& gradient ) {
+  fatal_if(util::ParseGradient(gradient.c_str(),&color_over_life),
+      "cannot parse color gradient %s",gradient.c_str());
+}
+
+void ParticleConfig::SetSizeOverLife( const std::string& gradient ) {
+  fatal_if(util::ParseGradient(gradient.c_str(),&size_over_life),
+      "cannot parse size gradient %s",gradient.c_str());
+}
+
+DINJECT_CLASS(ParticleConfig) {
+  dinject::Class<ParticleConfig>("particle.ParticleConfig")
+    .AddString("ColorOverLife",&ParticleConfig::SetColorOverLife)
+    .AddString("SizeOverLife" ,&ParticleConfig::SetSizeOverLife );
+}
+
+ParticleSystem::ParticleSystem( const ParticleConfig& config ,
+                                RenderBatch* batch ,
+                                const sf::IntRect& texture_rect ):
+  config_            (config),
+  buffer_            (config.max_particles),
+  position_x_        (0.0f),
+  position_y_        (0.0f),
+  emitting_          (false),
+  age_               (0.0f),
+  emit_residue_      (0.0f),
+  parallel_threshold_(kDefaultParallelThreshold),
+  feature_           (GetFeature(config)),
+  rng_               (config.seed ? config.seed : RandomSeed()),
+  batch_             (batch),
+  shape_             (texture_rect),
+  lut_               (config.color_over_life,config.size_over_life)
+{}
+
+void ParticleSystem::Fire() {
+  emitting_     = true;
+  age_          = 0.0f;
+  emit_residue_ = 0.0f;
+}
+
+void ParticleSystem::Seed( std::uint64_t seed ) {
+  rng_.Seed(seed);
+}
+
+void ParticleSystem::Stop( bool kill ) {
+  emitting_ = false;
+  if(kill) buffer_.Clear();
+}
+
+void ParticleSystem::Update( float delta ) {
+  SFE_TRACE_SCOPE("ParticleSystem::Update");
+  // the slots after the living particles are dead , so the kernel can run
+  // over the whole last lane
+  typedef detail::ParticleBuffer B;
+  auto last   = (buffer_.size() + B::kLaneSize - 1) / B::kLaneSize * B::kLaneSize;
+  auto kernel = detail::GetParticleKernel(feature_);
+  std::size_t dead = 0;
+  if(buffer_.size() < parallel_threshold_) {
+    dead = kernel(&buffer_,0,last,position_x_,position_y_,delta);
+  } else {
+    // every chunk starts at a multiple of kParallelChunk , which is a
+    // multiple of the lane size
+    std::atomic<std::size_t> count(0);
+    JobSystem::GetInstance().ParallelFor(0,last,kParallelChunk,
+        [this,kernel,delta,&count]( std::size_t b , std::size_t e ) {
+          count.fetch_add(kernel(&buffer_,b,e,position_x_,position_y_,delta),
+                          std::memory_order_relaxed);
+        });
+    dead = count.load();
+  }
+  if(dead) buffer_.Compact();
+  if(!emitting_) return;
+
+  age_ += delta;
+  if(config_.full_life >= 0.0f && age_ >= config_.full_life) {
+    emitting_ = false;
+    return;
+  }
+
+  auto count    = config_.rate * delta + emit_residue_;
+  auto spawn    = static_cast<std::size_t>(count);
+  emit_residue_ = count - spawn;
+  Spawn(spawn);
+}
+
+void ParticleSystem::Spawn( std::size_t count ) {
+  typedef detail::ParticleBuffer B;
+  const auto& c = config_;
+  auto n = static_cast<std::size_t>(c.max_particles);
+
+  count = std::min(count,n - std::min(n,buffer_.size()));
+  auto first = buffer_.Allocate(count);
+  auto field = [this,first]( B::Field f ) { return buffer_[f] + first; };
+
+  // the random values are generated in bulk straight into the fields , the
+  // velocity fields hold the angle and the speed until the loop below
+  // converts them
+  FloatRange angle(c.direction - c.spread * 0.5f,c.direction + c.spread * 0.5f);
+
+  c.spawn_x       .FillRandom(field(B::POSITION_X    ),count,&rng_);
+  c.spawn_y       .FillRandom(field(B::POSITION_Y    ),count,&rng_);
+  angle           .FillRandom(field(B::VELOCITY_X    ),count,&rng_);
+  c.speed         .FillRandom(field(B::VELOCITY_Y    ),count,&rng_);
+  c.gravity       .FillRandom(field(B::GRAVITY       ),count,&rng_);
+  c.radial_acc    .FillRandom(field(B::RADIAL_ACC    ),count,&rng_);
+  c.tangential_acc.FillRandom(field(B::TANGENTIAL_ACC),count,&rng_);
+  c.spin          .FillRandom(field(B::SPIN          ),count,&rng_);
+  c.spin_delta    .FillRandom(field(B::SPIN_DELTA    ),count,&rng_);
+  c.size          .FillRandom(field(B::SIZE          ),count,&rng_);
+  c.life          .FillRandom(field(B::LIFE          ),count,&rng_);
+
+  for( auto i = first ; i < first + count ; ++i ) {
+    auto angle = buffer_[B::VELOCITY_X][i];
+    auto speed = buffer_[B::VELOCITY_Y][i];
+
+    buffer_[B::POSITION_X][i] += position_x_;
+    buffer_[B::POSITION_Y][i] += position_y_;
+    buffer_[B::VELOCITY_X][i]  = std::cos(angle) * speed;
+    buffer_[B::VELOCITY_Y][i]  = std::sin(angle) * speed;
+    buffer_[B::AGE       ][i]  = 0.0f;
+  }
+}
+
+void ParticleSystem::Render() {
+  auto count  = buffer_.size();
+  auto output = batch_->GetFillVertex(batch_->BeginFill(count));
+  if(count < parallel_threshold_) {
+    detail::EmitParticleQuads(&buffer_,0,count,shape_,lut_,output);
+    return;
+  }
+
+  JobSystem::GetInstance().ParallelFor(0,count,kParallelChunk,
+      [this,output]( std::size_t b , std::size_t e ) {
+        detail::EmitParticleQuads(&buffer_,b,e,shape_,lut_,output + b * 4);
+      });
+}
+
+} // namespace sfe
@@ -1,10 +1,150 @@
 #include "random.h"
 
+#include <algorithm>
+#include <atomic>
+#include <cmath>
+#include <random>
+
+#if defined(__SSE2__)
+#include <emmintrin.h>
+#endif
+
 namespace sfe {
+namespace {
+
+// splitmix64 , expands a seed into the generator states
+std::uint64_t SplitMix( std::uint64_t* x ) {
+  auto z = (*x += 0x9e3779b97f4a7c15ull);
+  z = (z ^ (z >> 30)) * 0xbf58476d1ce4e5b9ull;
+  z = (z ^ (z >> 27)) * 0x94d049bb133111ebull;
+  return z ^ (z >> 31);
+}
+
+std::uint64_t RandomSeed() {
+  static std::atomic<std::uint64_t> kCounter(0);
+  std::random_device rd;
+  return (static_cast<std::uint64_t>(rd()) << 32 | rd()) ^
+         kCounter.fetch_add(0x9e3779b97f4a7c15ull);
+}
+
+} // namespace
+
+const std::size_t Random::kLaneSize;
 
 Random& Random::GetInstance() {
-  static Random kInstance;
+  thread_local Random kInstance(RandomSeed());
   return kInstance;
 }
 
+void Random::Seed( std::uint64_t seed ) {
+  auto x = seed;
+  for( std::size_t i = 0 ; i < 4 ; i += 2 ) {
+    auto v = SplitMix(&x);
+    state_[i  ] = static_cast<std::uint32_t>(v);
+    state_[i+1] = static_cast<std::uint32_t>(v >> 32);
+  }
+  for( std::size_t k = 0 ; k < kLaneSize ; ++k ) {
+    for( std::size_t i = 0 ; i < 4 ; i += 2 ) {
+      auto v = SplitMix(&x);
+      lane_[i  ][k] = static_cast<std::uint32_t>(v);
+      lane_[i+1][k] = static_cast<std::uint32_t>(v >> 32);
+    }
+  }
+}
+
+void Random::NextLane( std::uint32_t* output ) {
+#if defined(__SSE2__)
+  for( std::size_t k = 0 ; k < kLaneSize ; k += 4 ) {
+    auto s0 = _mm_load_si128(reinterpret_cast<const __m128i*>(lane_[0] + k));
+    auto s1 = _mm_load_si128(reinterpret_cast<const __m128i*>(lane_[1] + k));
+    auto s2 = _mm_load_si128(reinterpret_cast<const __m128i*>(lane_[2] + k));
+    auto s3 = _mm_load_si128(reinterpret_cast<const __m128i*>(lane_[3] + k));
+
+    _mm_storeu_si128(reinterpret_cast<__m128i*>(output + k),_mm_add_epi32(s0,s3));
+    auto t = _mm_slli_epi32(s1,9);
+    s2 = _mm_xor_si128(s2,s0);
+    s3 = _mm_xor_si128(s3,s1);
+    s1 = _mm_xor_si128(s1,s2);
+    s0 = _mm_xor_si128(s0,s3);
+    s2 = _mm_xor_si128(s2,t);
+    s3 = _mm_or_si128(_mm_slli_epi32(s3,11),_mm_srli_epi32(s3,21));
+
+    _mm_store_si128(reinterpret_cast<__m128i*>(lane_[0] + k),s0);
+    _mm_store_si128(reinterpret_cast<__m128i*>(lane_[1] + k),s1);
+    _mm_store_si128(reinterpret_cast<__m128i*>(lane_[2] + k),s2);
+    _mm_store_si128(reinterpret_cast<__m128i*>(lane_[3] + k),s3);
+  }
+#else
+  for( std::size_t k = 0 ; k < kLaneSize ; ++k ) {
+    auto& s0 = lane_[0][k];
+    auto& s1 = lane_[1][k];
+    auto& s2 = lane_[2][k];
+    auto& s3 = lane_[3][k];
+
+    output[k] = s0 + s3;
+    auto t = s1 << 9;
+    s2 ^= s0;
+    s3 ^= s1;
+    s1 ^= s2;
+    s0 ^= s3;
+    s2 ^= t;
+    s3  = Rotate(s3,11);
+  }
+#endif // __SSE2__
+}
+
+void Random::FillBits( std::uint32_t* output , std::size_t count ) {
+  std::size_t i = 0;
+  for( ; i + kLaneSize <= count ; i += kLaneSize ) NextLane(output + i);
+
+  if(i < count) {
+    std::uint32_t rest[kLaneSize];
+    NextLane(rest);
+    std::copy(rest,rest + (count - i),output + i);
+  }
+}
+
+void Random::Fill( float* output , std::size_t count , float l , float u ) {
+  // l + x * scale can round up to u , clamp to the largest float below u
+  const float scale = (u - l) * (1.0f / 16777216.0f);
+  const float upper = std::nextafter(u,l);
+  alignas(16) std::uint32_t bits [kLaneSize];
+  alignas(16) float         value[kLaneSize];
+
+  for( std::size_t i = 0 ; i < count ; i += kLaneSize ) {
+    // write the last partial step into value first
+    auto n   = std::min(kLaneSize,count - i);
+    auto out = n == kLaneSize ? output + i : value;
+
+    // the top 24 bits convert to float exactly
+    NextLane(bits);
+#if defined(__SSE2__)
+    for( std::size_t k = 0 ; k < kLaneSize ; k += 4 ) {
+      auto b = _mm_load_si128(reinterpret_cast<const __m128i*>(bits + k));
+      auto f = _mm_cvtepi32_ps(_mm_srli_epi32(b,8));
+      f = _mm_add_ps(_mm_set1_ps(l),_mm_mul_ps(f,_mm_set1_ps(scale)));
+      _mm_storeu_ps(out + k,_mm_min_ps(f,_mm_set1_ps(upper)));
+    }
+#else
+    for( std::size_t k = 0 ; k < kLaneSize ; ++k )
+      out[k] = std::min(l + static_cast<float>(bits[k] >> 8) * scale,upper);
+#endif // __SSE2__
+    if(out == value) std::copy(value,value + n,output + i);
+  }
+}
+
+void Random::Fill( std::int32_t* output , std::size_t count , std::int32_t l ,
+                                                              std::int32_t u ) {
+  auto range = static_cast<std::uint64_t>(static_cast<std::int64_t>(u) - l) + 1;
+  alignas(16) std::uint32_t bits[kLaneSize];
+
+  for( std::size_t i = 0 ; i < count ; i += kLaneSize ) {
+    NextLane(bits);
+    auto n = std::min(kLaneSize,count - i);
+    for( std::size_t k = 0 ; k < n ; ++k )
+      output[i + k] = static_cast<std::int32_t>(l + static_cast<std::int64_t>(
+          (static_cast<std::uint64_t>(bits[k]) * range) >> 32));
+  }
+}
+
 } // namespace sfe
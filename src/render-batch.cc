@@ -1,13 +1,149 @@
 #include "render-batch.h"
 #include "util.h"
+#include "trace.h"
+#include "job-system.h"
+
+#include <algorithm>
+
+#if defined(__AVX__)
+#include <immintrin.h>
+#elif defined(__SSE2__)
+#include <emmintrin.h>
+#endif
 
 namespace sfe {
+namespace {
+
+#if defined(__SSE2__)
+inline __m128 TransformLane( __m128 x , __m128 y , float m0 , float m1 ,
+                                                   float t ) {
+  return _mm_add_ps(_mm_add_ps(_mm_mul_ps(_mm_set1_ps(m0),x),
+                               _mm_mul_ps(_mm_set1_ps(m1),y)),
+                    _mm_set1_ps(t));
+}
+#endif // __SSE2__
+
+inline void StoreQuad( const sf::Vertex* in , const float* x , const float* y ,
+                                              sf::Vertex* out ) {
+  for( std::size_t i = 0 ; i < 4 ; ++i ) {
+    out[i].position  = sf::Vector2f(x[i],y[i]);
+    out[i].color     = in[i].color;
+    out[i].texCoords = in[i].texCoords;
+  }
+}
+
+// Transform 4 corners of a single quad. The x and y of each corner are
+// gathered into one SSE register, since sf::Vertex is 20 bytes there's no
+// way to load them directly
+inline void TransformQuadImpl( const QuadTransform& t , const sf::Vertex* in ,
+                                                        sf::Vertex* out ) {
+#if defined(__SSE2__)
+  alignas(16) float ox[4];
+  alignas(16) float oy[4];
+
+  __m128 x = _mm_setr_ps(in[0].position.x,in[1].position.x,
+                         in[2].position.x,in[3].position.x);
+  __m128 y = _mm_setr_ps(in[0].position.y,in[1].position.y,
+                         in[2].position.y,in[3].position.y);
+
+  _mm_store_ps(ox,TransformLane(x,y,t.a,t.b,t.tx));
+  _mm_store_ps(oy,TransformLane(x,y,t.c,t.d,t.ty));
+#else
+  float ox[4];
+  float oy[4];
+  for( std::size_t i = 0 ; i < 4 ; ++i ) {
+    ox[i] = t.a * in[i].position.x + t.b * in[i].position.y + t.tx;
+    oy[i] = t.c * in[i].position.x + t.d * in[i].position.y + t.ty;
+  }
+#endif // __SSE2__
+  StoreQuad(in,ox,oy,out);
+}
+
+#if defined(__AVX__)
+inline __m256 TransformLane( __m256 x , __m256 y , __m256 m0 , __m256 m1 ,
+                                                   __m256 t ) {
+  return _mm256_add_ps(_mm256_add_ps(_mm256_mul_ps(m0,x),
+                                     _mm256_mul_ps(m1,y)),t);
+}
+
+// Transform 2 quads , 8 corners , with one AVX register. The lower 4 lanes
+// belong to the first quad and the upper 4 lanes belong to the second one
+inline void TransformQuadPair( const QuadTransform& t0 , const sf::Vertex* in0 ,
+                               const QuadTransform& t1 , const sf::Vertex* in1 ,
+                               sf::Vertex* out0 , sf::Vertex* out1 ) {
+  alignas(32) float ox[8];
+  alignas(32) float oy[8];
+
+  __m256 x = _mm256_setr_ps(in0[0].position.x,in0[1].position.x,
+                            in0[2].position.x,in0[3].position.x,
+                            in1[0].position.x,in1[1].position.x,
+                            in1[2].position.x,in1[3].position.x);
+  __m256 y = _mm256_setr_ps(in0[0].position.y,in0[1].position.y,
+                            in0[2].position.y,in0[3].position.y,
+                            in1[0].position.y,in1[1].position.y,
+                            in1[2].position.y,in1[3].position.y);
+
+  __m256 a  = _mm256_setr_m128(_mm_set1_ps(t0.a ),_mm_set1_ps(t1.a ));
+  __m256 b  = _mm256_setr_m128(_mm_set1_ps(t0.b ),_mm_set1_ps(t1.b ));
+  __m256 tx = _mm256_setr_m128(_mm_set1_ps(t0.tx),_mm_set1_ps(t1.tx));
+  __m256 c  = _mm256_setr_m128(_mm_set1_ps(t0.c ),_mm_set1_ps(t1.c ));
+  __m256 d  = _mm256_setr_m128(_mm_set1_ps(t0.d ),_mm_set1_ps(t1.d ));
+  __m256 ty = _mm256_setr_m128(_mm_set1_ps(t0.ty),_mm_set1_ps(t1.ty));
+
+  _mm256_store_ps(ox,TransformLane(x,y,a,b,tx));
+  _mm256_store_ps(oy,TransformLane(x,y,c,d,ty));
+
+  StoreQuad(in0,ox  ,oy  ,out0);
+  StoreQuad(in1,ox+4,oy+4,out1);
+}
+#endif // __AVX__
+
+// GetQuad returns the transform and the corner array of the ith quad
+template< typename GetQuad >
+void TransformQuadList( std::size_t count , sf::Vertex* output ,
+                                            const GetQuad& get ) {
+  std::size_t i = 0;
+
+#if defined(__AVX__)
+  for( ; i + 2 <= count ; i += 2 ) {
+    QuadTransform t0 , t1;
+    const sf::Vertex* in0 = get(i  ,&t0);
+    const sf::Vertex* in1 = get(i+1,&t1);
+    TransformQuadPair(t0,in0,t1,in1,output + i*4 , output + (i+1)*4);
+  }
+#endif // __AVX__
+
+  for( ; i < count ; ++i ) {
+    QuadTransform t;
+    const sf::Vertex* in = get(i,&t);
+    TransformQuadImpl(t,in,output + i*4);
+  }
+}
+
+void TransformQuads( const QuadTransform* trans , const sf::Vertex* corner ,
+                                                 std::size_t count ,
+                                                 sf::Vertex* output ) {
+  TransformQuadList(count,output,
+      [trans,corner]( std::size_t i , QuadTransform* t ) {
+        *t = trans[i];
+        return corner + i * 4;
+      });
+}
+
+} // namespace
+
+void TransformQuad( const QuadTransform& t , const sf::Vertex* corner ,
+                                             sf::Vertex* output ) {
+  TransformQuadImpl(t,corner,output);
+}
 
 DINJECT_CLASS(RenderBatch) {
   dinject::Class<RenderBatch>("graphics.RenderBatch")
     .AddString("BlendMode",&RenderBatch::SetBlendMode)
     .AddString("Texture"  ,&RenderBatch::SetTexture  )
-    .AddString("Shader"   ,&RenderBatch::SetShader   );
+    .AddString("Shader"   ,&RenderBatch::SetShader   )
+    .AddString("Backend"  ,&RenderBatch::SetBackend  )
+    .AddPrimitive("QuadList",&RenderBatch::SetQuadList);
 }
 
 void RenderBatch::SetBlendMode( const std::string& blend_mode ) {
@@ -18,18 +154,138 @@ void RenderBatch::SetBlendMode( const std::string& blend_mode ) {
 void RenderBatch::SetTexture  ( const std::string& ) {}
 void RenderBatch::SetShader   ( const std::string& ) {}
 
+void RenderBatch::SetBackend  ( const std::string& backend ) {
+  if(backend == "client-array")
+    backend_ = CLIENT_ARRAY;
+  else if(backend == "stream-buffer")
+    backend_ = STREAM_BUFFER;
+  else
+    fatal("unknown render batch backend %s",backend.c_str());
+}
+
 void RenderBatch::Enqueue( const sf::Vertex& v , const sf::Transform& trans ) {
   sf::Vertex temp(v);
   temp.position = trans.transformPoint(temp.position);
-  varray_.append(temp);
+  vertex_.push_back(temp);
+}
+
+// Only the dirty quads need to be transformed , the rest is a copy of the
+// cached world vertex
+void RenderBatch::CopyQuads( const Quad* const* quad , std::size_t count ,
+                                                       sf::Vertex* output ) {
+  std::size_t i = 0;
+
+#if defined(__AVX__)
+  // the dirty quads are transformed in pairs straight into their cache , a
+  // dirty quad waits in pending until the next one shows up
+  std::size_t pending = count;
+  for( ; i < count ; ++i ) {
+    auto q = quad[i];
+    if(q->dirty_) {
+      if(pending == count) {
+        pending = i;
+        continue;
+      }
+
+      auto p = quad[pending];
+      TransformQuadPair(QuadTransform(p->getTransform()),p->vertex_,
+                        QuadTransform(q->getTransform()),q->vertex_,
+                        p->world_,q->world_);
+      p->dirty_ = q->dirty_ = false;
+      std::memcpy(output + pending * 4,p->world_,sizeof(sf::Vertex) * 4);
+      pending = count;
+    }
+    std::memcpy(output + i * 4,q->world_,sizeof(sf::Vertex) * 4);
+  }
+
+  if(pending != count) {
+    std::memcpy(output + pending * 4,quad[pending]->GetWorldVertex(),
+                sizeof(sf::Vertex) * 4);
+  }
+#endif // __AVX__
+
+  for( ; i < count ; ++i ) {
+    std::memcpy(output + i * 4,quad[i]->GetWorldVertex(),
+                sizeof(sf::Vertex) * 4);
+  }
+}
+
+void RenderBatch::EnqueueQuads( const QuadTransform* trans ,
+                                const sf::Vertex* corner ,
+                                std::size_t count ) {
+  auto base = vertex_.size();
+  vertex_.resize(base + count * 4);
+  TransformQuads(trans,corner,count,vertex_.data() + base);
+}
+
+void RenderBatch::EnqueueQuads( const Quad* const* quad , std::size_t count ) {
+  auto base = vertex_.size();
+  vertex_.resize(base + count * 4);
+  CopyQuads(quad,count,vertex_.data() + base);
+}
+
+void RenderBatch::FillQuads( std::size_t first , const Quad* const* quad ,
+                                                 std::size_t count ) {
+  assert( (first + count) * 4 <= vertex_.size() );
+  CopyQuads(quad,count,vertex_.data() + first * 4);
+}
+
+void RenderBatch::FillQuads( std::size_t first , const QuadTransform* trans ,
+                                                 const sf::Vertex* corner ,
+                                                 std::size_t count ) {
+  assert( (first + count) * 4 <= vertex_.size() );
+  TransformQuads(trans,corner,count,vertex_.data() + first * 4);
+}
+
+void RenderBatch::EnqueueQuadsParallel( const Quad* const* quad ,
+                                        std::size_t count ,
+                                        std::size_t job_count ) {
+  auto first = BeginFill(count);
+  job_count  = std::max<std::size_t>(1,std::min(job_count,count));
+
+  auto grain = (count + job_count - 1) / job_count;
+  JobSystem::GetInstance().ParallelFor(0,count,grain,
+      [this,first,quad]( std::size_t b , std::size_t e ) {
+        FillQuads(first + b,quad + b,e - b);
+      });
+}
+
+bool RenderBatch::RenderStream( sf::RenderTarget* target ,
+                                const sf::RenderStates& states ) {
+  if(!stream_) {
+    if(!VertexStream::IsAvailable()) return false;
+    stream_.reset(new VertexStream(type_,
+          std::max(reserve_ * 4,VertexStream::kDefaultCapacity)));
+  }
+
+  std::size_t offset;
+  if(!stream_->Upload(vertex_.data(),vertex_.size(),&offset))
+    return false;
+
+  if(quad_list_)
+    gl::DrawQuadList(target,states,stream_->buffer(),offset,vertex_.size()/4);
+  else
+    stream_->Draw(target,offset,vertex_.size(),states);
+  return true;
 }
 
 void RenderBatch::Render( sf::RenderTarget* target ) {
+  SFE_TRACE_SCOPE("RenderBatch::Render");
   sf::RenderStates states;
+  states.blendMode = blend_mode_;
   if(texture_) states.texture = texture_;
   if(shader_ ) states.shader  = shader_ ;
-  target->draw(varray_,states);
-  varray_.clear();
+  if(!vertex_.empty()) {
+    assert( !quad_list_ || vertex_.size() % 4 == 0 );
+
+    if(backend_ != STREAM_BUFFER || !RenderStream(target,states)) {
+      if(quad_list_)
+        gl::DrawQuadList(target,states,vertex_.data(),vertex_.size()/4);
+      else
+        target->draw(vertex_.data(),vertex_.size(),type_,states);
+    }
+  }
+  vertex_.clear();
 }
 
 } // namespace sfe
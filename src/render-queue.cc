@@ -0,0 +1,231 @@
+#include "render-queue.h"
+
+#include <algorithm>
+#include <cstring>
+
+namespace sfe {
+namespace {
+
+const std::uint64_t kTextureMask = (1u << RenderQueue::kTextureBits) - 1;
+const std::uint64_t kShaderMask  = (1u << RenderQueue::kShaderBits ) - 1;
+const std::uint64_t kBlendMask   = (1u << RenderQueue::kBlendBits  ) - 1;
+
+inline std::uint32_t GetTexture( std::uint64_t state ) {
+  return static_cast<std::uint32_t>(state & kTextureMask);
+}
+
+inline std::uint32_t GetShader( std::uint64_t state ) {
+  return static_cast<std::uint32_t>((state >> RenderQueue::kTextureBits) &
+                                    kShaderMask);
+}
+
+inline std::uint32_t GetBlend( std::uint64_t state ) {
+  return static_cast<std::uint32_t>((state >> (RenderQueue::kTextureBits +
+                                               RenderQueue::kShaderBits)) &
+                                    kBlendMask);
+}
+
+} // namespace
+
+RenderQueue::RenderQueue():
+  item_          (),
+  order_         (),
+  temp_          (),
+  vertex_        (),
+  merge_         (),
+  blend_         (1,sf::BlendAlpha),
+  shader_        (1,NULL),
+  texture_       (1,NULL),
+  shader_id_     (),
+  texture_id_    (),
+  last_state_    (0),
+  has_last_state_(false),
+  stats_         ()
+{}
+
+std::uint32_t RenderQueue::GetBlendModeId( const sf::BlendMode& bm ) {
+  auto itr = std::find(blend_.begin(),blend_.end(),bm);
+  if(itr != blend_.end())
+    return static_cast<std::uint32_t>(itr - blend_.begin());
+
+  fatal_if(blend_.size() <= kBlendMask,"too many blend modes:%zu",blend_.size());
+  blend_.push_back(bm);
+  return static_cast<std::uint32_t>(blend_.size() - 1);
+}
+
+std::uint32_t RenderQueue::GetShaderId( const sf::Shader* shader ) {
+  if(!shader) return 0;
+  auto itr = shader_id_.find(shader);
+  if(itr != shader_id_.end()) return itr->second;
+
+  fatal_if(shader_.size() <= kShaderMask,"too many shaders:%zu",shader_.size());
+  auto id = static_cast<std::uint32_t>(shader_.size());
+  shader_.push_back(shader);
+  shader_id_[shader] = id;
+  return id;
+}
+
+std::uint32_t RenderQueue::GetTextureId( const sf::Texture* texture ) {
+  if(!texture) return 0;
+  auto itr = texture_id_.find(texture);
+  if(itr != texture_id_.end()) return itr->second;
+
+  fatal_if(texture_.size() <= kTextureMask,"too many textures:%zu",
+                                           texture_.size());
+  auto id = static_cast<std::uint32_t>(texture_.size());
+  texture_.push_back(texture);
+  texture_id_[texture] = id;
+  return id;
+}
+
+std::uint64_t RenderQueue::MakeKey( const RenderBatch& batch ,
+                                    std::uint8_t layer ,
+                                    std::uint32_t depth ) {
+  return MakeKey(layer,GetBlendModeId(batch.blend_mode()),
+                       GetShaderId   (batch.shader()),
+                       GetTextureId  (batch.texture()),
+                       depth);
+}
+
+void RenderQueue::Submit( const Quad& quad , std::uint64_t key ) {
+  auto first = vertex_.size();
+  vertex_.resize(first + 4);
+  quad.GetWorldVertex(vertex_.data() + first);
+
+  Item item = { key , static_cast<std::uint32_t>(first) , 4 , NULL };
+  item_.push_back(item);
+}
+
+void RenderQueue::Submit( RenderBatch* batch , std::uint64_t key ) {
+  if(!batch->vertex_count()) return;
+
+  if(batch->quad_list()) {
+    auto first = vertex_.size();
+    auto count = batch->vertex_count();
+    vertex_.resize(first + count);
+    std::memcpy(vertex_.data() + first,batch->vertex(),
+                count * sizeof(sf::Vertex));
+    batch->Clear();
+
+    Item item = { key , static_cast<std::uint32_t>(first) ,
+                        static_cast<std::uint32_t>(count) , NULL };
+    item_.push_back(item);
+  } else {
+    Item item = { key , 0 , 0 , batch };
+    item_.push_back(item);
+  }
+}
+
+void RenderQueue::Sort() {
+  auto n = item_.size();
+  order_.resize(n);
+  temp_ .resize(n);
+  for( std::size_t i = 0 ; i < n ; ++i )
+    order_[i] = static_cast<std::uint32_t>(i);
+
+  // build histogram of all 8 digits in one pass
+  std::uint32_t histogram[8][256];
+  std::memset(histogram,0,sizeof(histogram));
+  for( auto& e : item_ ) {
+    for( int d = 0 ; d < 8 ; ++d )
+      ++histogram[d][(e.key >> (d*8)) & 0xff];
+  }
+
+  for( int d = 0 ; d < 8 ; ++d ) {
+    auto* h = histogram[d];
+
+    // all items have the same digit , this pass doesn't change anything
+    if(h[(item_.front().key >> (d*8)) & 0xff] == n) continue;
+
+    std::uint32_t offset = 0;
+    for( std::size_t i = 0 ; i < 256 ; ++i ) {
+      auto c = h[i];
+      h[i] = offset;
+      offset += c;
+    }
+
+    for( auto idx : order_ ) {
+      auto digit = (item_[idx].key >> (d*8)) & 0xff;
+      temp_[h[digit]++] = idx;
+    }
+    order_.swap(temp_);
+  }
+}
+
+sf::RenderStates RenderQueue::GetStates( std::uint64_t state ) const {
+  sf::RenderStates states;
+  states.blendMode = blend_  [GetBlend  (state)];
+  states.shader    = shader_ [GetShader (state)];
+  states.texture   = texture_[GetTexture(state)];
+  return states;
+}
+
+void RenderQueue::TrackState( std::uint64_t state ) {
+  if(has_last_state_) {
+    if(GetBlend  (state) != GetBlend  (last_state_)) ++stats_.state_change;
+    if(GetShader (state) != GetShader (last_state_)) ++stats_.state_change;
+    if(GetTexture(state) != GetTexture(last_state_)) ++stats_.state_change;
+  }
+  last_state_     = state;
+  has_last_state_ = true;
+}
+
+void RenderQueue::Draw( sf::RenderTarget* target , std::uint64_t state ) {
+  if(merge_.empty()) return;
+
+  TrackState(state);
+  gl::DrawQuadList(target,GetStates(state),merge_.data(),merge_.size()/4);
+  ++stats_.draw_call;
+  stats_.vertex += merge_.size();
+  merge_.clear();
+}
+
+void RenderQueue::Clear() {
+  for( auto& e : item_ ) {
+    if(e.batch) e.batch->Clear();
+  }
+  item_  .clear();
+  vertex_.clear();
+}
+
+void RenderQueue::Flush( sf::RenderTarget* target ) {
+  stats_ = Stats();
+  stats_.submission = item_.size();
+  has_last_state_   = false;
+
+  if(!item_.empty()) {
+    Sort();
+
+    std::uint64_t state = GetStateKey(item_[order_.front()].key);
+
+    for( auto idx : order_ ) {
+      const auto& item = item_[idx];
+      auto s = GetStateKey(item.key);
+
+      if(s != state) {
+        Draw(target,state);
+        state = s;
+      }
+
+      if(item.batch) {
+        // the batch is not mergeable , flush the current run and let the
+        // batch render itself
+        Draw(target,state);
+        TrackState(state);
+        stats_.vertex += item.batch->vertex_count();
+        item.batch->Render(target);
+        ++stats_.draw_call;
+      } else {
+        merge_.insert(merge_.end(),vertex_.begin() + item.first ,
+                                   vertex_.begin() + item.first + item.count);
+      }
+    }
+
+    Draw(target,state);
+  }
+
+  item_  .clear();
+  vertex_.clear();
+}
+
+} // namespace sfe
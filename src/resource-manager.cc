@@ -1,5 +1,361 @@
-#include ".resource-manager.h"
+#include "resource-manager.h"
+#include "trace.h"
+#include "job-system.h"
+
+#include <algorithm>
+#include <atomic>
+#include <cctype>
+#include <filesystem>
+#include <fstream>
+#include <iomanip>
+#include <iostream>
 
 namespace sfe {
+namespace fs = std::filesystem;
+namespace {
+
+const char* kAtlasFolder   = ".atlas";
+const char* kAtlasManifest = "manifest.txt";
+const char* kAtlasMagic    = "sfe-atlas";
+
+bool IsImage( const fs::path& p ) {
+  auto ext = p.extension().string();
+  std::transform(ext.begin(),ext.end(),ext.begin(),::tolower);
+  return ext == ".png" || ext == ".jpg" || ext == ".jpeg" ||
+         ext == ".bmp" || ext == ".tga";
+}
+
+std::string GetPagePath( const fs::path& cache , std::size_t index ) {
+  return (cache / ("page-" + std::to_string(index) + ".png")).string();
+}
+
+// FNV-1a hash
+void Hash( std::uint64_t* h , const void* data , std::size_t size ) {
+  auto p = static_cast<const unsigned char*>(data);
+  for( std::size_t i = 0 ; i < size ; ++i ) {
+    *h ^= p[i];
+    *h *= 1099511628211ULL;
+  }
+}
+
+// Decode image files on the job system , decoding is pure CPU work while the
+// texture upload has to stay on the thread owning the GL context
+bool DecodeImage( const std::vector<std::string>& file ,
+                  std::vector<sf::Image>* output ) {
+  SFE_TRACE_SCOPE("DecodeImage");
+  output->resize(file.size());
+
+  std::atomic<bool> ok(true);
+  JobSystem::GetInstance().ParallelFor(0,file.size(),1,
+      [&]( std::size_t first , std::size_t last ) {
+        for( std::size_t i = first ; i < last ; ++i ) {
+          if(!(*output)[i].loadFromFile(file[i])) ok = false;
+        }
+      });
+  return ok;
+}
+
+} // namespace
+
+ResourceManager::ResourceManager( const std::string& path ):
+  path_      (path),
+  texture_   (),
+  shader_    (),
+  region_    (),
+  atlas_page_()
+{}
+
+bool ResourceManager::LoadLevel( const std::string& name , bool atlas ) {
+  SFE_TRACE_SCOPE("ResourceManager::LoadLevel");
+  std::error_code ec;
+  fs::path dir = fs::path(path_) / name;
+  if(!fs::is_directory(dir,ec)) {
+    std::cerr << "level " << name << " is not found under " << path_ << std::endl;
+    return false;
+  }
+
+  std::vector<Image> image;
+  std::map<std::string,std::pair<std::string,std::string>> shader;
+
+  for( auto& e : fs::directory_iterator(dir,ec) ) {
+    if(!e.is_regular_file()) continue;
+    const auto& p = e.path();
+    auto stem = p.stem().string();
+
+    if(IsImage(p)) {
+      image.push_back(Image{stem,p.string()});
+    } else if(p.extension() == ".vert") {
+      shader[stem].first  = p.string();
+    } else if(p.extension() == ".frag") {
+      shader[stem].second = p.string();
+    }
+  }
+  if(ec) return false;
+
+  // directory iteration order is unspecified , keep it stable
+  std::sort(image.begin(),image.end(),
+      []( const Image& l , const Image& r ) { return l.name < r.name; });
+
+  for( auto& e : shader ) {
+    std::unique_ptr<sf::Shader> s(new sf::Shader());
+    bool ok;
+    if(e.second.first.empty())
+      ok = s->loadFromFile(e.second.second,sf::Shader::Fragment);
+    else if(e.second.second.empty())
+      ok = s->loadFromFile(e.second.first ,sf::Shader::Vertex);
+    else
+      ok = s->loadFromFile(e.second.first,e.second.second);
+
+    if(!ok) return false;
+    shader_[e.first] = std::move(s);
+  }
+
+  if(atlas) return LoadAtlas(dir.string(),image);
+
+  std::vector<std::string> file;
+  for( auto& e : image ) file.push_back(e.file);
+
+  std::vector<sf::Image> decoded;
+  if(!DecodeImage(file,&decoded)) return false;
+
+  for( std::size_t i = 0 ; i < image.size() ; ++i ) {
+    std::unique_ptr<sf::Texture> t(new sf::Texture());
+    if(!t->loadFromImage(decoded[i])) return false;
+    texture_[image[i].name] = std::move(t);
+  }
+  return true;
+}
+
+bool ResourceManager::LoadAtlas( const std::string& dir ,
+                                 const std::vector<Image>& image ) {
+  SFE_TRACE_SCOPE("ResourceManager::LoadAtlas");
+  int page_size = std::min(static_cast<int>(kAtlasPageSize),
+                           static_cast<int>(sf::Texture::getMaximumSize()));
+  int padding   = kAtlasPadding;
+
+  // the signature covers everything that affects the pack result
+  std::uint64_t signature = 14695981039346656037ULL;
+  Hash(&signature,&page_size,sizeof(page_size));
+  Hash(&signature,&padding  ,sizeof(padding));
+  for( auto& e : image ) {
+    std::error_code ec;
+    auto sz    = static_cast<std::uint64_t>(fs::file_size(e.file,ec));
+    auto mtime = fs::last_write_time(e.file,ec).time_since_epoch().count();
+    Hash(&signature,e.name.data(),e.name.size());
+    Hash(&signature,&sz,sizeof(sz));
+    Hash(&signature,&mtime,sizeof(mtime));
+  }
+
+  if(LoadAtlasCache(dir,signature,image)) return true;
+
+  std::vector<std::string> file;
+  for( auto& e : image ) file.push_back(e.file);
+
+  std::vector<sf::Image> source;
+  if(!DecodeImage(file,&source)) return false;
+
+  std::vector<sf::Vector2i> size(image.size());
+  for( std::size_t i = 0 ; i < image.size() ; ++i )
+    size[i] = sf::Vector2i(source[i].getSize());
+
+  std::vector<AtlasEntry> entry;
+  auto page_count = PackAtlas(size,page_size,padding,&entry);
+
+  std::vector<sf::Image> page(page_count);
+  for( auto& e : page )
+    e.create(page_size,page_size,sf::Color::Transparent);
+
+  for( std::size_t i = 0 ; i < image.size() ; ++i ) {
+    const auto& e = entry[i];
+    if(e.page < 0) continue;
+    page[e.page].copy(source[i],e.rect.left,e.rect.top);
+  }
+
+  auto first = atlas_page_.size();
+  for( auto& e : page ) {
+    std::unique_ptr<sf::Texture> t(new sf::Texture());
+    if(!t->loadFromImage(e)) return false;
+    atlas_page_.push_back(std::move(t));
+  }
+
+  for( std::size_t i = 0 ; i < image.size() ; ++i ) {
+    const auto& e = entry[i];
+    if(e.page < 0) {
+      // too large for a page , use a standalone texture
+      std::unique_ptr<sf::Texture> t(new sf::Texture());
+      if(!t->loadFromImage(source[i])) return false;
+      texture_[image[i].name] = std::move(t);
+    } else {
+      auto& r = region_[image[i].name];
+      r.texture = atlas_page_[first + e.page].get();
+      r.rect    = e.rect;
+    }
+  }
+
+  if(!SaveAtlasCache(dir,signature,page,image,entry)) {
+    std::cerr << "cannot save atlas cache under " << dir << std::endl;
+  }
+  return true;
+}
+
+bool ResourceManager::LoadAtlasCache( const std::string& dir ,
+                                      std::uint64_t signature ,
+                                      const std::vector<Image>& image ) {
+  auto cache = fs::path(dir) / kAtlasFolder;
+  std::ifstream input((cache / kAtlasManifest).string());
+  if(!input) return false;
+
+  std::string magic;
+  std::uint64_t sig;
+  std::size_t page_count;
+  if(!(input >> magic >> std::hex >> sig >> std::dec >> page_count) ||
+     magic != kAtlasMagic || sig != signature)
+    return false;
+
+  // a page index of -1 is an image too large for a page , it is loaded from
+  // its source file as a standalone texture
+  std::map<std::string,std::pair<int,sf::IntRect>> entry;
+  std::string name;
+  int         index;
+  sf::IntRect rect;
+  while(input >> std::quoted(name) >> index >> rect.left  >> rect.top
+                                            >> rect.width >> rect.height) {
+    if(index < -1 || index >= static_cast<int>(page_count)) return false;
+    entry[name] = std::make_pair(index,rect);
+  }
+  if(!input.eof()) return false;
+
+  // a manifest not covering every image of the level is stale
+  std::vector<std::string> file;
+  for( std::size_t i = 0 ; i < page_count ; ++i )
+    file.push_back(GetPagePath(cache,i));
+
+  std::vector<const Image*> standalone;
+  for( auto& e : image ) {
+    auto itr = entry.find(e.name);
+    if(itr == entry.end()) return false;
+    if(itr->second.first < 0) {
+      standalone.push_back(&e);
+      file.push_back(e.file);
+    }
+  }
+  if(entry.size() != image.size()) return false;
+
+  std::vector<sf::Image> decoded;
+  if(!DecodeImage(file,&decoded)) return false;
+
+  std::vector<std::unique_ptr<sf::Texture>> page(page_count);
+  for( std::size_t i = 0 ; i < page_count ; ++i ) {
+    page[i].reset(new sf::Texture());
+    if(!page[i]->loadFromImage(decoded[i])) return false;
+  }
+
+  std::vector<std::unique_ptr<sf::Texture>> texture(standalone.size());
+  for( std::size_t i = 0 ; i < standalone.size() ; ++i ) {
+    texture[i].reset(new sf::Texture());
+    if(!texture[i]->loadFromImage(decoded[page_count + i])) return false;
+  }
+
+  for( auto& e : entry ) {
+    if(e.second.first < 0) continue;
+    auto& r = region_[e.first];
+    r.texture = page[e.second.first].get();
+    r.rect    = e.second.second;
+  }
+  for( std::size_t i = 0 ; i < standalone.size() ; ++i )
+    texture_[standalone[i]->name] = std::move(texture[i]);
+  for( auto& e : page ) atlas_page_.push_back(std::move(e));
+  return true;
+}
+
+bool ResourceManager::SaveAtlasCache( const std::string& dir ,
+                                      std::uint64_t signature ,
+                                      const std::vector<sf::Image>& page ,
+                                      const std::vector<Image>& image ,
+                                      const std::vector<AtlasEntry>& entry ) const {
+  std::error_code ec;
+  auto cache = fs::path(dir) / kAtlasFolder;
+  fs::create_directories(cache,ec);
+  if(ec) return false;
+
+  // png encoding is slow , encode the pages in parallel
+  std::atomic<bool> ok(true);
+  JobSystem::GetInstance().ParallelFor(0,page.size(),1,
+      [&]( std::size_t first , std::size_t last ) {
+        for( std::size_t i = first ; i < last ; ++i ) {
+          if(!page[i].saveToFile(GetPagePath(cache,i))) ok = false;
+        }
+      });
+  if(!ok) return false;
+
+  // write the manifest last , so a partial cache is never picked up
+  std::ofstream output((cache / kAtlasManifest).string());
+  output << kAtlasMagic << ' ' << std::hex << signature << std::dec << ' '
+         << page.size() << '\n';
+  for( std::size_t i = 0 ; i < image.size() ; ++i ) {
+    // page stays -1 for a standalone image
+    const auto& e = entry[i];
+    output << std::quoted(image[i].name) << ' ' << e.page << ' '
+           << e.rect.left  << ' ' << e.rect.top    << ' '
+           << e.rect.width << ' ' << e.rect.height << '\n';
+  }
+  return static_cast<bool>(output);
+}
+
+sf::Texture* ResourceManager::GetTexture( const std::string& name ) const {
+  auto itr = texture_.find(name);
+  if(itr != texture_.end()) return itr->second.get();
+
+  auto r = region_.find(name);
+  if(r != region_.end()) return r->second.texture;
+  return NULL;
+}
+
+sf::Shader* ResourceManager::GetShader( const std::string& name ) const {
+  auto itr = shader_.find(name);
+  return itr == shader_.end() ? NULL : itr->second.get();
+}
+
+bool ResourceManager::GetTextureRegion( const std::string& name ,
+                                        TextureRegion* output ) const {
+  auto r = region_.find(name);
+  if(r != region_.end()) {
+    *output = r->second;
+    return true;
+  }
+
+  auto itr = texture_.find(name);
+  if(itr != texture_.end()) {
+    auto sz = itr->second->getSize();
+    output->texture = itr->second.get();
+    output->rect    = sf::IntRect(0,0,static_cast<int>(sz.x),
+                                      static_cast<int>(sz.y));
+    return true;
+  }
+  return false;
+}
+
+void ResourceManager::Dump( std::ostream* output ) const {
+  for( auto& e : texture_ ) {
+    auto sz = e.second->getSize();
+    *output << "texture:" << e.first << "(" << sz.x << "x" << sz.y << ")\n";
+  }
+
+  for( auto& e : region_ ) {
+    auto page = std::find_if(atlas_page_.begin(),atlas_page_.end(),
+        [&e]( const std::unique_ptr<sf::Texture>& t ) {
+          return t.get() == e.second.texture;
+        }) - atlas_page_.begin();
+
+    const auto& r = e.second.rect;
+    *output << "atlas:" << e.first << "(page:" << page << ","
+            << r.left << "," << r.top << "," << r.width << "," << r.height
+            << ")\n";
+  }
+
+  for( auto& e : shader_ ) {
+    *output << "shader:" << e.first << "\n";
+  }
+}
 
 } // namespace sfe
@@ -0,0 +1,182 @@
+#include "spatial-grid.h"
+
+#include <algorithm>
+#include <cassert>
+#include <cmath>
+
+namespace sfe {
+namespace {
+
+bool Intersect( const sf::FloatRect& l , const sf::FloatRect& r ) {
+  return l.left < r.left + r.width  && r.left < l.left + l.width &&
+         l.top  < r.top  + r.height && r.top  < l.top  + l.height;
+}
+
+} // namespace
+
+SpatialGrid::SpatialGrid( float cell_size ):
+  cell_size_(cell_size),
+  cell_     (),
+  entry_    (),
+  free_     (),
+  order_    (0),
+  mark_     (),
+  stamp_    (0),
+  visible_  ()
+{ assert( cell_size > 0.0f ); }
+
+SpatialGrid::CellRange SpatialGrid::GetCellRange( const sf::FloatRect& r ) const {
+  CellRange range;
+  range.x0 = static_cast<int>(std::floor( r.left              / cell_size_));
+  range.y0 = static_cast<int>(std::floor( r.top               / cell_size_));
+  range.x1 = static_cast<int>(std::floor((r.left + r.width )  / cell_size_));
+  range.y1 = static_cast<int>(std::floor((r.top  + r.height)  / cell_size_));
+  return range;
+}
+
+void SpatialGrid::AddToCell( Handle h , const CellRange& range ) {
+  for( int y = range.y0 ; y <= range.y1 ; ++y ) {
+    for( int x = range.x0 ; x <= range.x1 ; ++x ) {
+      cell_[CellKey(x,y)].push_back(h);
+    }
+  }
+}
+
+void SpatialGrid::RemoveFromCell( Handle h , const CellRange& range ) {
+  for( int y = range.y0 ; y <= range.y1 ; ++y ) {
+    for( int x = range.x0 ; x <= range.x1 ; ++x ) {
+      auto itr = cell_.find(CellKey(x,y));
+      assert( itr != cell_.end() );
+
+      auto& list = itr->second;
+      auto  pos  = std::find(list.begin(),list.end(),h);
+      assert( pos != list.end() );
+      *pos = list.back();
+      list.pop_back();
+      if(list.empty()) cell_.erase(itr);
+    }
+  }
+}
+
+SpatialGrid::Handle SpatialGrid::Insert( const Quad* quad ) {
+  Handle h;
+  if(free_.empty()) {
+    h = static_cast<Handle>(entry_.size());
+    entry_.push_back(Entry());
+    mark_ .push_back(0);
+  } else {
+    h = free_.back();
+    free_.pop_back();
+  }
+
+  auto& e = entry_[h];
+  e.quad    = quad;
+  e.bounds  = quad->GetWorldBounds();
+  e.cell    = GetCellRange(e.bounds);
+  e.version = quad->version();
+  e.order   = order_++;
+  AddToCell(h,e.cell);
+  return h;
+}
+
+void SpatialGrid::Remove( Handle h ) {
+  auto& e = entry_[h];
+  assert( e.quad );
+  RemoveFromCell(h,e.cell);
+  e.quad = NULL;
+  free_.push_back(h);
+}
+
+void SpatialGrid::Update( Handle h ) {
+  auto& e = entry_[h];
+  assert( e.quad );
+  if(e.version == e.quad->version()) return;
+
+  e.version = e.quad->version();
+  e.bounds  = e.quad->GetWorldBounds();
+
+  auto range = GetCellRange(e.bounds);
+  if(range == e.cell) return;
+
+  RemoveFromCell(h,e.cell);
+  AddToCell     (h,range);
+  e.cell = range;
+}
+
+void SpatialGrid::Refresh() {
+  for( std::size_t i = 0 ; i < entry_.size() ; ++i ) {
+    if(entry_[i].quad) Update(static_cast<Handle>(i));
+  }
+}
+
+template< typename T >
+void SpatialGrid::Visit( const sf::FloatRect& rect , const T& visitor ) const {
+  if(++stamp_ == 0) {
+    // stamp wraps around , reset all the marks
+    std::fill(mark_.begin(),mark_.end(),0);
+    stamp_ = 1;
+  }
+
+  auto range = GetCellRange(rect);
+
+  // the view may cover a lot more cells than what we have , walk the
+  // occupied cells instead in this case
+  auto cells = static_cast<std::size_t>(range.x1 - range.x0 + 1) *
+               static_cast<std::size_t>(range.y1 - range.y0 + 1);
+
+  auto visit = [this,&rect,&visitor]( const std::vector<Handle>& list ) {
+    for( auto h : list ) {
+      if(mark_[h] == stamp_) continue;
+      mark_[h] = stamp_;
+      if(Intersect(entry_[h].bounds,rect)) visitor(h);
+    }
+  };
+
+  if(cells > cell_.size()) {
+    for( auto& e : cell_ ) {
+      auto x = static_cast<int>(static_cast<std::uint32_t>(e.first >> 32));
+      auto y = static_cast<int>(static_cast<std::uint32_t>(e.first));
+      if(x >= range.x0 && x <= range.x1 && y >= range.y0 && y <= range.y1)
+        visit(e.second);
+    }
+  } else {
+    for( int y = range.y0 ; y <= range.y1 ; ++y ) {
+      for( int x = range.x0 ; x <= range.x1 ; ++x ) {
+        auto itr = cell_.find(CellKey(x,y));
+        if(itr != cell_.end()) visit(itr->second);
+      }
+    }
+  }
+}
+
+void SpatialGrid::Query( const sf::FloatRect& rect ,
+                         std::vector<const Quad*>* output ) const {
+  Visit(rect,[this,output]( Handle h ) { output->push_back(entry_[h].quad); });
+}
+
+sf::FloatRect SpatialGrid::GetViewRect( const sf::View& view ) {
+  const auto& c = view.getCenter();
+  const auto& s = view.getSize();
+
+  // bounding box of the rotated view rectangle
+  auto rad = view.getRotation() * 3.14159265f / 180.0f;
+  auto cs  = std::fabs(std::cos(rad));
+  auto sn  = std::fabs(std::sin(rad));
+  auto w   = s.x * cs + s.y * sn;
+  auto h   = s.x * sn + s.y * cs;
+  return sf::FloatRect(c.x - w / 2.0f , c.y - h / 2.0f , w , h);
+}
+
+std::size_t SpatialGrid::Render( const sf::View& view ) {
+  visible_.clear();
+  Visit(GetViewRect(view),[this]( Handle h ) { visible_.push_back(h); });
+
+  // cells are walked in hash order , restore the insertion order
+  std::sort(visible_.begin(),visible_.end(),[this]( Handle l , Handle r ) {
+    return entry_[l].order < entry_[r].order;
+  });
+  for( auto h : visible_ ) entry_[h].quad->Render();
+  return visible_.size();
+}
+
+} // namespace sfe
@@ -0,0 +1,292 @@
+#include "sprite-instance-batch.h"
+#include "gl-util.h"
+
+#ifndef GL_GLEXT_PROTOTYPES
+#define GL_GLEXT_PROTOTYPES
+#endif // GL_GLEXT_PROTOTYPES
+#include <GL/gl.h>
+#include <GL/glext.h>
+
+#include <SFML/Window.hpp>
+#include <cmath>
+#include <cstddef>
+#include <iostream>
+
+namespace sfe {
+namespace {
+
+enum {
+  ATTR_CORNER = 0,
+  ATTR_POSITION_ROTATION,
+  ATTR_SCALE_ANCHOR,
+  ATTR_TEXTURE_RECT,
+  ATTR_COLOR
+};
+
+const char* kVertexShader =
+  "#version 120\n"
+  "attribute vec2 corner;\n"
+  "attribute vec3 position_rotation;\n"
+  "attribute vec4 scale_anchor;\n"
+  "attribute vec4 texture_rect;\n"
+  "attribute vec4 color;\n"
+  "varying   vec4 frag_color;\n"
+  "void main() {\n"
+  "  vec2  pixel = corner * texture_rect.zw;\n"
+  "  vec2  local = (pixel - scale_anchor.zw / 16.0) *\n"
+  "                (scale_anchor.xy / 256.0);\n"
+  "  float r     = radians(position_rotation.z);\n"
+  "  float c     = cos(r);\n"
+  "  float s     = sin(r);\n"
+  "  vec2  world = vec2(c * local.x - s * local.y ,\n"
+  "                     s * local.x + c * local.y) + position_rotation.xy;\n"
+  "  gl_Position    = gl_ModelViewProjectionMatrix * vec4(world,0.0,1.0);\n"
+  "  gl_TexCoord[0] = gl_TextureMatrix[0] *\n"
+  "                   vec4(texture_rect.xy + pixel,0.0,1.0);\n"
+  "  frag_color     = color;\n"
+  "}\n";
+
+const char* kFragmentShader =
+  "#version 120\n"
+  "uniform sampler2D sprite_texture;\n"
+  "uniform float     has_texture;\n"
+  "varying vec4      frag_color;\n"
+  "void main() {\n"
+  "  vec4 c = frag_color;\n"
+  "  if(has_texture > 0.5) c *= texture2D(sprite_texture,gl_TexCoord[0].xy);\n"
+  "  gl_FragColor = c;\n"
+  "}\n";
+
+// Corners in Quad's order , drawn as a triangle strip for each instance
+const float kCorner[] = { 0.0f , 0.0f ,
+                          0.0f , 1.0f ,
+                          1.0f , 0.0f ,
+                          1.0f , 1.0f };
+
+GLuint Compile( GLenum type , const char* source ) {
+  GLuint shader = glCreateShader(type);
+  glShaderSource (shader,1,&source,NULL);
+  glCompileShader(shader);
+
+  GLint ok;
+  glGetShaderiv(shader,GL_COMPILE_STATUS,&ok);
+  if(!ok) {
+    char log[1024];
+    glGetShaderInfoLog(shader,sizeof(log),NULL,log);
+    std::cerr << "cannot compile sprite instance shader:" << log << std::endl;
+    glDeleteShader(shader);
+    return 0;
+  }
+  return shader;
+}
+
+void SetDivisor( bool core , GLuint index , GLuint divisor ) {
+  if(core)
+    glVertexAttribDivisor   (index,divisor);
+  else
+    glVertexAttribDivisorARB(index,divisor);
+}
+
+} // namespace
+
+SpriteInstanceBatch::SpriteInstanceBatch( sf::BlendMode bm ,
+                                          const sf::Texture* texture ):
+  instance_         (),
+  blend_mode_       (bm),
+  texture_          (texture),
+  fallback_         (bm,texture),
+  fallback_trans_   (),
+  fallback_corner_  (),
+  state_            (UNKNOWN),
+  force_fallback_   (false),
+  core_             (false),
+  program_          (0),
+  corner_buffer_    (0),
+  instance_buffer_  (0),
+  instance_capacity_(0),
+  has_texture_loc_  (-1)
+{ fallback_.set_quad_list(true); }
+
+SpriteInstanceBatch::~SpriteInstanceBatch() {
+  if(state_ != AVAILABLE) return;
+
+  // GL objects can only be deleted with an active context , the contexts
+  // created by SFML share their objects
+  sf::Context context;
+  glDeleteBuffers(1,&corner_buffer_);
+  glDeleteBuffers(1,&instance_buffer_);
+  glDeleteProgram(program_);
+}
+
+bool SpriteInstanceBatch::Init() {
+  if(gl::IsVersionAtLeast(3,3)) {
+    core_ = true;
+  } else if(gl::IsVersionAtLeast(2,0) &&
+            gl::HasExtension("GL_ARB_instanced_arrays") &&
+            gl::HasExtension("GL_ARB_draw_instanced")) {
+    core_ = false;
+  } else {
+    return false;
+  }
+
+  auto vs = Compile(GL_VERTEX_SHADER  ,kVertexShader  );
+  auto fs = Compile(GL_FRAGMENT_SHADER,kFragmentShader);
+  if(!vs || !fs) {
+    if(vs) glDeleteShader(vs);
+    if(fs) glDeleteShader(fs);
+    return false;
+  }
+
+  program_ = glCreateProgram();
+  glAttachShader(program_,vs);
+  glAttachShader(program_,fs);
+  glBindAttribLocation(program_,ATTR_CORNER           ,"corner");
+  glBindAttribLocation(program_,ATTR_POSITION_ROTATION,"position_rotation");
+  glBindAttribLocation(program_,ATTR_SCALE_ANCHOR     ,"scale_anchor");
+  glBindAttribLocation(program_,ATTR_TEXTURE_RECT     ,"texture_rect");
+  glBindAttribLocation(program_,ATTR_COLOR            ,"color");
+  glLinkProgram(program_);
+  glDeleteShader(vs);
+  glDeleteShader(fs);
+
+  GLint ok;
+  glGetProgramiv(program_,GL_LINK_STATUS,&ok);
+  if(!ok) {
+    std::cerr << "cannot link sprite instance shader" << std::endl;
+    glDeleteProgram(program_);
+    program_ = 0;
+    return false;
+  }
+
+  glUseProgram(program_);
+  glUniform1i(glGetUniformLocation(program_,"sprite_texture"),0);
+  has_texture_loc_ = glGetUniformLocation(program_,"has_texture");
+  glUseProgram(0);
+
+  glGenBuffers(1,&corner_buffer_);
+  glBindBuffer(GL_ARRAY_BUFFER,corner_buffer_);
+  glBufferData(GL_ARRAY_BUFFER,sizeof(kCorner),kCorner,GL_STATIC_DRAW);
+  glGenBuffers(1,&instance_buffer_);
+  glBindBuffer(GL_ARRAY_BUFFER,0);
+  return true;
+}
+
+void SpriteInstanceBatch::RenderInstanced( sf::RenderTarget* target ,
+                                           const sf::RenderStates& states ) {
+  auto count = instance_.size();
+  auto bytes = count * sizeof(SpriteInstance);
+
+  gl::BeginDraw(target,states);
+
+  // resetGLStates leaves SFML's client arrays enabled with stale pointers ,
+  // the compatibility profile could still fetch from them during the draw.
+  // EndDraw enables them again
+  glDisableClientState(GL_VERTEX_ARRAY);
+  glDisableClientState(GL_COLOR_ARRAY);
+  glDisableClientState(GL_TEXTURE_COORD_ARRAY);
+
+  // orphan the instance buffer every frame , the buffer only grows
+  glBindBuffer(GL_ARRAY_BUFFER,instance_buffer_);
+  if(count > instance_capacity_) instance_capacity_ = count;
+  glBufferData   (GL_ARRAY_BUFFER,instance_capacity_ * sizeof(SpriteInstance),
+                                  NULL,GL_STREAM_DRAW);
+  glBufferSubData(GL_ARRAY_BUFFER,0,bytes,instance_.data());
+
+  const char* base = NULL;
+  const GLsizei stride = sizeof(SpriteInstance);
+  glVertexAttribPointer(ATTR_POSITION_ROTATION,3,GL_FLOAT,GL_FALSE,stride,
+                        base + offsetof(SpriteInstance,x));
+  glVertexAttribPointer(ATTR_SCALE_ANCHOR,4,GL_SHORT,GL_FALSE,stride,
+                        base + offsetof(SpriteInstance,scale_x));
+  glVertexAttribPointer(ATTR_TEXTURE_RECT,4,GL_UNSIGNED_SHORT,GL_FALSE,stride,
+                        base + offsetof(SpriteInstance,tex_left));
+  glVertexAttribPointer(ATTR_COLOR,4,GL_UNSIGNED_BYTE,GL_TRUE,stride,
+                        base + offsetof(SpriteInstance,color));
+
+  glBindBuffer(GL_ARRAY_BUFFER,corner_buffer_);
+  glVertexAttribPointer(ATTR_CORNER,2,GL_FLOAT,GL_FALSE,0,NULL);
+  glBindBuffer(GL_ARRAY_BUFFER,0);
+
+  for( GLuint i = ATTR_CORNER ; i <= ATTR_COLOR ; ++i ) {
+    glEnableVertexAttribArray(i);
+    SetDivisor(core_,i,i == ATTR_CORNER ? 0 : 1);
+  }
+
+  glUseProgram(program_);
+  glUniform1f(has_texture_loc_,texture_ ? 1.0f : 0.0f);
+
+  if(core_)
+    glDrawArraysInstanced   (GL_TRIANGLE_STRIP,0,4,static_cast<GLsizei>(count));
+  else
+    glDrawArraysInstancedARB(GL_TRIANGLE_STRIP,0,4,static_cast<GLsizei>(count));
+
+  // the divisor is a global state , leaving it set breaks SFML's draw
+  for( GLuint i = ATTR_CORNER ; i <= ATTR_COLOR ; ++i ) {
+    SetDivisor(core_,i,0);
+    glDisableVertexAttribArray(i);
+  }
+  glUseProgram(0);
+
+  gl::EndDraw(target);
+}
+
+void SpriteInstanceBatch::RenderFallback( sf::RenderTarget* target ) {
+  auto& trans  = fallback_trans_;
+  auto& corner = fallback_corner_;
+  trans .resize(instance_.size());
+  corner.resize(instance_.size() * 4);
+
+  for( std::size_t i = 0 ; i < instance_.size() ; ++i ) {
+    const auto& e = instance_[i];
+    auto  r  = e.rotation * 3.14159265f / 180.0f;
+    auto  c  = std::cos(r);
+    auto  s  = std::sin(r);
+    auto  sx = e.scale_x / 256.0f;
+    auto  sy = e.scale_y / 256.0f;
+    auto  ax = e.anchor_x / 16.0f;
+    auto  ay = e.anchor_y / 16.0f;
+    auto& t  = trans[i];
+
+    // the same matrix as sf::Transformable::getTransform
+    t.a  =  c * sx; t.b = -s * sy;
+    t.c  =  s * sx; t.d =  c * sy;
+    t.tx = e.x - (t.a * ax + t.b * ay);
+    t.ty = e.y - (t.c * ax + t.d * ay);
+
+    auto w = static_cast<float>(e.tex_width );
+    auto h = static_cast<float>(e.tex_height);
+    auto l = static_cast<float>(e.tex_left  );
+    auto u = static_cast<float>(e.tex_top   );
+    auto v = corner.data() + i * 4;
+    v[0] = sf::Vertex(sf::Vector2f(0,0),e.color,sf::Vector2f(l  ,u  ));
+    v[1] = sf::Vertex(sf::Vector2f(0,h),e.color,sf::Vector2f(l  ,u+h));
+    v[2] = sf::Vertex(sf::Vector2f(w,0),e.color,sf::Vector2f(l+w,u  ));
+    v[3] = sf::Vertex(sf::Vector2f(w,h),e.color,sf::Vector2f(l+w,u+h));
+  }
+
+  fallback_.EnqueueQuads(trans.data(),corner.data(),trans.size());
+  fallback_.Render(target);
+}
+
+void SpriteInstanceBatch::Render( sf::RenderTarget* target ) {
+  if(instance_.empty()) return;
+
+  if(state_ == UNKNOWN) {
+    // a context is needed to query the capability
+    target->setActive(true);
+    state_ = Init() ? AVAILABLE : UNAVAILABLE;
+  }
+
+  if(state_ == AVAILABLE && !force_fallback_) {
+    sf::RenderStates states;
+    states.blendMode = blend_mode_;
+    states.texture   = texture_;
+    RenderInstanced(target,states);
+  } else {
+    RenderFallback(target);
+  }
+
+  instance_.clear();
+}
+
+} // namespace sfe
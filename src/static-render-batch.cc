@@ -0,0 +1,88 @@
+#include "static-render-batch.h"
+#include "gl-util.h"
+
+#include <algorithm>
+#include <cstring>
+#include <limits>
+
+namespace sfe {
+
+StaticRenderBatch::StaticRenderBatch( sf::BlendMode bm ,
+                                      const sf::Texture* texture ,
+                                      const sf::Shader*  shader ):
+  vertex_     (),
+  buffer_     (sf::Triangles,sf::VertexBuffer::Static),
+  buffer_size_(0),
+  dirty_begin_(std::numeric_limits<std::size_t>::max()),
+  dirty_end_  (0),
+  blend_mode_ (bm),
+  texture_    (texture),
+  shader_     (shader),
+  valid_      (false)
+{}
+
+void StaticRenderBatch::Build( const Quad* const* quad , std::size_t count ) {
+  vertex_.resize(count * 4);
+  for( std::size_t i = 0 ; i < count ; ++i )
+    quad[i]->GetWorldVertex(vertex_.data() + i * 4);
+
+  MarkDirty(0,vertex_.size());
+  valid_ = true;
+}
+
+void StaticRenderBatch::Update( std::size_t first , const Quad* const* quad ,
+                                                    std::size_t count ) {
+  assert( valid_ );
+  assert( first + count <= quad_count() );
+
+  for( std::size_t i = 0 ; i < count ; ++i )
+    quad[i]->GetWorldVertex(vertex_.data() + (first + i) * 4);
+
+  MarkDirty(first * 4,(first + count) * 4);
+}
+
+void StaticRenderBatch::Invalidate() {
+  vertex_.clear();
+  dirty_begin_ = std::numeric_limits<std::size_t>::max();
+  dirty_end_   = 0;
+  valid_       = false;
+}
+
+bool StaticRenderBatch::Upload() {
+  if(!sf::VertexBuffer::isAvailable()) return false;
+
+  // the buffer size doesn't match after a rebuild , upload everything
+  if(buffer_size_ != vertex_.size()) {
+    if(!buffer_.create(vertex_.size())) return false;
+    buffer_size_ = vertex_.size();
+    dirty_begin_ = 0;
+    dirty_end_   = vertex_.size();
+  }
+
+  if(dirty_begin_ < dirty_end_) {
+    if(!buffer_.update(vertex_.data() + dirty_begin_ ,
+                       dirty_end_ - dirty_begin_ ,
+                       static_cast<unsigned>(dirty_begin_)))
+      return false;
+
+    dirty_begin_ = std::numeric_limits<std::size_t>::max();
+    dirty_end_   = 0;
+  }
+  return true;
+}
+
+void StaticRenderBatch::Render( sf::RenderTarget* target ) {
+  if(!valid_ || vertex_.empty()) return;
+
+  sf::RenderStates states;
+  states.blendMode = blend_mode_;
+  states.texture   = texture_;
+  states.shader    = shader_;
+
+  if(Upload())
+    gl::DrawQuadList(target,states,buffer_,0,quad_count());
+  else
+    gl::DrawQuadList(target,states,vertex_.data(),quad_count());
+}
+
+} // namespace sfe
@@ -0,0 +1,125 @@
+#include "trace.h"
+
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+
+namespace sfe   {
+namespace trace {
+namespace {
+
+std::uint64_t SteadyNow() {
+  return std::chrono::duration_cast<std::chrono::nanoseconds>(
+      std::chrono::steady_clock::now().time_since_epoch()).count();
+}
+
+void WriteString( FILE* output , const char* str ) {
+  std::fputc('"',output);
+  for( ; *str ; ++str ) {
+    if(*str == '"' || *str == '\\') std::fputc('\\',output);
+    std::fputc(*str,output);
+  }
+  std::fputc('"',output);
+}
+
+} // namespace
+
+const std::size_t Recorder::kMaxEventPerThread;
+
+Recorder& Recorder::GetInstance() {
+  static Recorder kInstance;
+  return kInstance;
+}
+
+Recorder::Recorder():
+  buffer_(),
+  lock_  (),
+  epoch_ (SteadyNow())
+{}
+
+std::uint64_t Recorder::Now() const {
+  return SteadyNow() - epoch_;
+}
+
+Recorder::ThreadBuffer* Recorder::GetThreadBuffer() {
+  // each thread registers its buffer once , the buffer is owned by the
+  // Recorder so it survives the thread for Flush
+  thread_local ThreadBuffer* kBuffer = NULL;
+  if(!kBuffer) {
+    std::lock_guard<std::mutex> lock(lock_);
+    buffer_.emplace_back(new ThreadBuffer());
+    kBuffer = buffer_.back().get();
+    kBuffer->id      = static_cast<std::uint32_t>(buffer_.size());
+    kBuffer->dropped = 0;
+    kBuffer->event.reserve(4096);
+  }
+  return kBuffer;
+}
+
+void Recorder::Record( const char* name , char phase ) {
+  auto ts = Now();
+  auto b  = GetThreadBuffer();
+  if(b->event.size() == kMaxEventPerThread) {
+    ++b->dropped;
+    return;
+  }
+  b->event.push_back(Event{name,ts,phase});
+}
+
+void Recorder::SetThreadName( const char* name ) {
+  GetThreadBuffer()->name = name;
+}
+
+bool Recorder::Flush( const char* file ) const {
+  FILE* output = std::fopen(file,"w");
+  if(!output) return false;
+
+  std::lock_guard<std::mutex> lock(lock_);
+  bool first = true;
+
+  std::fprintf(output,"{\"displayTimeUnit\":\"ns\",\"traceEvents\":[\n");
+  for( auto& b : buffer_ ) {
+    if(!b->name.empty()) {
+      std::fprintf(output,"%s{\"ph\":\"M\",\"name\":\"thread_name\","
+                          "\"pid\":1,\"tid\":%u,\"args\":{\"name\":",
+                          first ? "" : ",\n",b->id);
+      WriteString(output,b->name.c_str());
+      std::fprintf(output,"}}");
+      first = false;
+    }
+
+    for( auto& e : b->event ) {
+      std::fprintf(output,"%s{\"ph\":\"%c\",\"pid\":1,\"tid\":%u,"
+                          "\"ts\":%.3f,\"name\":",
+                          first ? "" : ",\n",e.phase,b->id,
+                          e.timestamp / 1000.0);
+      WriteString(output,e.name);
+      std::fputc('}',output);
+      first = false;
+    }
+
+    if(b->dropped) {
+      std::fprintf(stderr,"trace: %zu events dropped on thread %u\n",
+                   b->dropped,b->id);
+    }
+  }
+  std::fprintf(output,"\n]}\n");
+
+  return std::fclose(output) == 0;
+}
+
+bool Recorder::Flush() const {
+  const char* file = std::getenv("SFE_TRACE_FILE");
+  return Flush(file ? file : "sfe-trace.json");
+}
+
+void Recorder::Clear() {
+  std::lock_guard<std::mutex> lock(lock_);
+  for( auto& b : buffer_ ) {
+    b->event.clear();
+    b->dropped = 0;
+  }
+}
+
+} // namespace trace
+} // namespace sfe
@@ -3,6 +3,8 @@
 #include <cstring>
 #include <cctype>
 #include <cassert>
+#include <cstdlib>
+#include <limits>
 
 
 namespace sfe {
@@ -203,8 +205,67 @@ inline sf::BlendMode::Factor BlendModeTokenizer::MapFactor( int tk ) {
   }
 }
 
+// Parse a time:v0,v1,... stop of count values in [lower,upper] at *cursor
+// and move *cursor after it and its ';'
+bool ParseGradientStop( const char** cursor , float* time , float* value ,
+                        std::size_t count , float lower , float upper ) {
+  char* end;
+  *time = std::strtof(*cursor,&end);
+  if(end == *cursor || *end != ':' || !(*time >= 0.0f && *time <= 1.0f))
+    return false;
+
+  for( std::size_t i = 0 ; i < count ; ++i ) {
+    const char* start = end + 1;
+    value[i] = std::strtof(start,&end);
+    if(end == start || !(value[i] >= lower && value[i] <= upper))
+      return false;
+    if(i + 1 < count && *end != ',') return false;
+  }
+
+  while(std::isspace(*end)) ++end;
+  if(*end == ';')
+    ++end;
+  else if(*end)
+    return false;
+  *cursor = end;
+  return true;
+}
+
+template< std::size_t N , typename T , typename F >
+bool ParseGradientImpl( const char* source , std::vector<GradientStop<T> >* output ,
+                        float lower , float upper , const F& convert ) {
+  std::vector<GradientStop<T> > stops;
+  for(;;) {
+    while(std::isspace(*source)) ++source;
+    if(!*source) break;
+
+    float time , value[N];
+    if(!ParseGradientStop(&source,&time,value,N,lower,upper)) return false;
+    stops.push_back(GradientStop<T>(time,convert(value)));
+  }
+  if(stops.empty()) return false;
+  output->swap(stops);
+  return true;
+}
+
 } // namespace
 
+bool ParseGradient( const char* source , ColorGradient* output ) {
+  return ParseGradientImpl<4>(source,output,0.0f,255.0f,
+      []( const float* v ) {
+        return Color(static_cast<std::uint8_t>(v[3]),
+                     static_cast<std::uint8_t>(v[0]),
+                     static_cast<std::uint8_t>(v[1]),
+                     static_cast<std::uint8_t>(v[2]));
+      });
+}
+
+bool ParseGradient( const char* source , FloatGradient* output ) {
+  return ParseGradientImpl<1>(source,output,0.0f,
+                              std::numeric_limits<float>::max(),
+                              []( const float* v ) { return v[0]; });
+}
+
 bool ParseBlendMode( const char* source , sf::BlendMode* output ) {
   BlendModeTokenizer t(source);
   auto tk = t.Next();
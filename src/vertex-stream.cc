@@ -0,0 +1,56 @@
+#include "vertex-stream.h"
+
+#include <cassert>
+
+namespace sfe {
+
+const std::size_t VertexStream::kDefaultCapacity;
+
+VertexStream::VertexStream( sf::PrimitiveType type , std::size_t capacity ):
+  buffer_      (type,sf::VertexBuffer::Stream),
+  capacity_    (capacity),
+  head_        (0),
+  orphan_count_(0),
+  upload_bytes_(0),
+  created_     (false)
+{}
+
+bool VertexStream::Orphan( std::size_t count ) {
+  auto cap = capacity_ ? capacity_ : kDefaultCapacity;
+  while(cap < count) cap *= 2;
+
+  // sf::VertexBuffer::create issues a glBufferData with NULL data , which
+  // gives us fresh storage while the GPU keeps reading the old one
+  if(!buffer_.create(cap)) return false;
+
+  capacity_ = cap;
+  head_     = 0;
+  created_  = true;
+  ++orphan_count_;
+  return true;
+}
+
+bool VertexStream::Upload( const sf::Vertex* vertex , std::size_t count ,
+                                                      std::size_t* offset ) {
+  assert(count);
+
+  if(!created_ || head_ + count > capacity_) {
+    if(!Orphan(count)) return false;
+  }
+
+  if(!buffer_.update(vertex,count,static_cast<unsigned>(head_)))
+    return false;
+
+  *offset = head_;
+  head_  += count;
+  upload_bytes_ += count * sizeof(sf::Vertex);
+  return true;
+}
+
+void VertexStream::Draw( sf::RenderTarget* target , std::size_t offset ,
+                                                    std::size_t count ,
+                                                    const sf::RenderStates& states ) const {
+  target->draw(buffer_,offset,count,states);
+}
+
+} // namespace sfe
@@ -0,0 +1,99 @@
+#include <include/app.h>
+#include <gtest/gtest.h>
+
+#include <vector>
+
+namespace sfe {
+
+namespace {
+
+class HeadlessApp : public App {
+ public:
+  explicit HeadlessApp( const Headless& headless ):
+    App(60,headless),
+    init_ (false),
+    close_(false),
+    delta_(),
+    key_  ()
+  {}
+
+  virtual bool HandleInit() { init_ = true; return true; }
+
+  virtual void HandleUpdate( float delta , sf::RenderTarget* target ) {
+    delta_.push_back(delta);
+    target_ = target;
+  }
+
+  virtual bool HandleEvent( const sf::Event& event ) {
+    if(event.type == sf::Event::KeyPressed) {
+      key_.push_back(frame_index());
+      return false;
+    }
+    return App::HandleEvent(event);
+  }
+
+  virtual void HandleClose() { close_ = true; }
+
+  bool init_;
+  bool close_;
+  std::vector<float> delta_;
+  std::vector<std::size_t> key_;
+  sf::RenderTarget* target_;
+};
+
+} // namespace
+
+TEST(App,Headless) {
+  App::Headless headless;
+  headless.frame         = 100;
+  headless.deterministic = true;
+  headless.throttle      = false;
+
+  HeadlessApp app(headless);
+  ASSERT_EQ(NULL,app.window());
+  ASSERT_EQ(NULL,app.target());
+
+  ASSERT_TRUE(app.Start());
+  ASSERT_TRUE(app.init_);
+  ASSERT_TRUE(app.close_);
+  ASSERT_EQ(NULL,app.target_);
+
+  // deterministic stepping , every frame is exactly 1/fps
+  ASSERT_EQ(100u,app.delta_.size());
+  for( auto e : app.delta_ ) ASSERT_FLOAT_EQ(1.0f / 60.0f,e);
+}
+
+TEST(App,ScriptedEvent) {
+  App::Headless headless;
+  headless.deterministic = true;
+  headless.throttle      = false;
+
+  HeadlessApp app(headless);
+
+  sf::Event key;
+  key.type = sf::Event::KeyPressed;
+  app.PushEvent(3,key);
+  app.PushEvent(3,key);
+  app.PushEvent(7,key);
+
+  sf::Event close;
+  close.type = sf::Event::Closed;
+  app.PushEvent(10,close);
+
+  ASSERT_TRUE(app.Start());
+  ASSERT_EQ(3u,app.key_.size());
+  ASSERT_EQ(3u,app.key_[0]);
+  ASSERT_EQ(3u,app.key_[1]);
+  ASSERT_EQ(7u,app.key_[2]);
+
+  // the close event is handled at the start of frame 10 , which still
+  // runs to the end
+  ASSERT_EQ(11u,app.delta_.size());
+}
+
+} // namespace sfe
+
+int main( int argc , char* argv[] ) {
+  testing::InitGoogleTest(&argc,argv);
+  return RUN_ALL_TESTS();
+}
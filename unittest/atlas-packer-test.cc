@@ -0,0 +1,72 @@
+#include <include/atlas-packer.h>
+#include <gtest/gtest.h>
+
+namespace sfe {
+
+namespace {
+
+bool Overlap( const sf::IntRect& l , const sf::IntRect& r ) {
+  return l.left < r.left + r.width  && r.left < l.left + l.width &&
+         l.top  < r.top  + r.height && r.top  < l.top  + l.height;
+}
+
+} // namespace
+
+TEST(AtlasPacker,Skyline) {
+  SkylinePacker packer(64,64);
+  sf::IntRect r1 , r2 , r3 , r4;
+
+  ASSERT_TRUE(packer.Insert(32,32,&r1));
+  ASSERT_TRUE(packer.Insert(32,32,&r2));
+  ASSERT_TRUE(packer.Insert(64,32,&r3));
+  ASSERT_FALSE(packer.Insert(1,1,&r4));
+
+  ASSERT_FALSE(Overlap(r1,r2));
+  ASSERT_FALSE(Overlap(r1,r3));
+  ASSERT_FALSE(Overlap(r2,r3));
+  ASSERT_EQ(1.0f,packer.occupancy());
+
+  packer.Reset();
+  ASSERT_TRUE(packer.Insert(64,64,&r1));
+  ASSERT_EQ(0,r1.left);
+  ASSERT_EQ(0,r1.top);
+}
+
+TEST(AtlasPacker,PackAtlas) {
+  std::vector<sf::Vector2i> size;
+  for( int i = 0 ; i < 200 ; ++i )
+    size.push_back(sf::Vector2i(8 + (i * 7) % 50 , 8 + (i * 13) % 40));
+  size.push_back(sf::Vector2i(300,10)); // too large for a page
+
+  std::vector<AtlasEntry> output;
+  int pages = PackAtlas(size,256,1,&output);
+
+  ASSERT_EQ(size.size(),output.size());
+  ASSERT_LE(1,pages);
+  ASSERT_EQ(-1,output.back().page);
+
+  for( std::size_t i = 0 ; i < output.size() - 1 ; ++i ) {
+    const auto& e = output[i];
+    ASSERT_LE(0,e.page);
+    ASSERT_LT(e.page,pages);
+    ASSERT_EQ(size[i].x,e.rect.width);
+    ASSERT_EQ(size[i].y,e.rect.height);
+    ASSERT_LE(1,e.rect.left);
+    ASSERT_LE(1,e.rect.top);
+    ASSERT_LE(e.rect.left + e.rect.width  + 1, 256);
+    ASSERT_LE(e.rect.top  + e.rect.height + 1, 256);
+
+    for( std::size_t j = i + 1 ; j < output.size() - 1 ; ++j ) {
+      if(output[j].page == e.page) {
+        ASSERT_FALSE(Overlap(e.rect,output[j].rect));
+      }
+    }
+  }
+}
+
+} // namespace sfe
+
+int main( int argc, char* argv[] ) {
+  testing::InitGoogleTest(&argc,argv);
+  return RUN_ALL_TESTS();
+}
@@ -0,0 +1,79 @@
+#include <include/frame-profiler.h>
+#include <gtest/gtest.h>
+
+#include <cstdio>
+#include <fstream>
+#include <string>
+
+namespace sfe {
+
+TEST(FrameProfiler,Scope) {
+  auto& profiler = FrameProfiler::GetInstance();
+
+  auto id = profiler.RegisterScope("physics");
+  ASSERT_GE(id,static_cast<int>(FrameProfiler::SIZE_OF_BUILTIN_SCOPE));
+  ASSERT_EQ(id,profiler.RegisterScope("physics"));
+  ASSERT_EQ(static_cast<int>(FrameProfiler::SCOPE_UPDATE),
+            profiler.RegisterScope("update"));
+  ASSERT_EQ("physics",profiler.scope_name(id));
+}
+
+TEST(FrameProfiler,Stats) {
+  auto& profiler = FrameProfiler::GetInstance();
+  profiler.Reset();
+
+  FrameProfiler::Stats stats;
+  ASSERT_FALSE(profiler.GetStats(FrameProfiler::SCOPE_UPDATE,&stats));
+
+  // 1ms .. 100ms , recorded in 2 parts to check accumulation
+  for( int i = 1 ; i <= 100 ; ++i ) {
+    profiler.Record(FrameProfiler::SCOPE_UPDATE,i * 500000);
+    profiler.Record(FrameProfiler::SCOPE_UPDATE,i * 500000);
+    profiler.EndFrame();
+  }
+  ASSERT_EQ(100u,profiler.frame_count());
+
+  ASSERT_TRUE(profiler.GetStats(FrameProfiler::SCOPE_UPDATE,&stats));
+  ASSERT_DOUBLE_EQ(1.0  ,stats.min);
+  ASSERT_DOUBLE_EQ(100.0,stats.max);
+  ASSERT_DOUBLE_EQ(50.5 ,stats.avg);
+  ASSERT_DOUBLE_EQ(99.0 ,stats.p99);
+
+  // the ring buffer only keeps the last kFrameSize frames
+  for( std::size_t i = 0 ; i < FrameProfiler::kFrameSize ; ++i ) {
+    profiler.Record(FrameProfiler::SCOPE_UPDATE,2000000);
+    profiler.EndFrame();
+  }
+  ASSERT_TRUE(profiler.GetStats(FrameProfiler::SCOPE_UPDATE,&stats));
+  ASSERT_DOUBLE_EQ(2.0,stats.min);
+  ASSERT_DOUBLE_EQ(2.0,stats.max);
+}
+
+TEST(FrameProfiler,DumpCSV) {
+  auto& profiler = FrameProfiler::GetInstance();
+  profiler.Reset();
+
+  for( int i = 0 ; i < 3 ; ++i ) {
+    { ProfileScope scope(FrameProfiler::SCOPE_EVENT); }
+    profiler.EndFrame();
+  }
+
+  const char* file = "frame-profiler-test.csv";
+  ASSERT_TRUE(profiler.DumpCSV(file));
+
+  std::ifstream input(file);
+  std::string line;
+  std::size_t count = 0;
+  ASSERT_TRUE(std::getline(input,line));
+  ASSERT_EQ(0u,line.find("frame,frame_ms,event_ms,update_ms"));
+  while(std::getline(input,line)) ++count;
+  ASSERT_EQ(3u,count);
+  std::remove(file);
+}
+
+} // namespace sfe
+
+int main( int argc , char* argv[] ) {
+  testing::InitGoogleTest(&argc,argv);
+  return RUN_ALL_TESTS();
+}
@@ -0,0 +1,107 @@
+#include <include/job-system.h>
+#include <gtest/gtest.h>
+
+#include <atomic>
+#include <numeric>
+#include <vector>
+
+namespace sfe {
+
+TEST(JobSystem,Run) {
+  JobSystem jobs(3);
+  std::atomic<int> sum(0);
+
+  JobCounter counter;
+  for( int i = 1 ; i <= 5000 ; ++i )
+    jobs.Run(&counter,[&sum,i]() { sum += i; });
+  jobs.Wait(&counter);
+
+  ASSERT_TRUE(counter.done());
+  ASSERT_EQ(5000 * 5001 / 2,sum.load());
+}
+
+TEST(JobSystem,Nested) {
+  JobSystem jobs(2);
+  std::atomic<int> count(0);
+
+  // every job spawns and waits for its own children
+  JobCounter counter;
+  for( int i = 0 ; i < 16 ; ++i ) {
+    jobs.Run(&counter,[&jobs,&count]() {
+      JobCounter child;
+      for( int j = 0 ; j < 16 ; ++j )
+        jobs.Run(&child,[&count]() { ++count; });
+      jobs.Wait(&child);
+      ++count;
+    });
+  }
+  jobs.Wait(&counter);
+  ASSERT_EQ(16 * 17,count.load());
+}
+
+TEST(JobSystem,ParallelFor) {
+  for( std::size_t worker : { 0 , 1 , 4 } ) {
+    JobSystem jobs(worker);
+    std::vector<int> data(100003,0);
+
+    jobs.ParallelFor(0,data.size(),1000,[&data]( std::size_t b , std::size_t e ) {
+      for( std::size_t i = b ; i < e ; ++i ) data[i] += static_cast<int>(i % 7);
+    });
+
+    long long expect = 0;
+    for( std::size_t i = 0 ; i < data.size() ; ++i ) {
+      ASSERT_EQ(static_cast<int>(i % 7),data[i]);
+      expect += i % 7;
+    }
+    ASSERT_EQ(expect,std::accumulate(data.begin(),data.end(),0LL));
+  }
+}
+
+TEST(JobSystem,ForeignThread) {
+  JobSystem jobs(2);
+  std::atomic<int> count(0);
+
+  // jobs submitted from a thread that owns no deque go through the shared
+  // queue
+  std::thread t([&jobs,&count]() {
+    JobCounter counter;
+    for( int i = 0 ; i < 100 ; ++i )
+      jobs.Run(&counter,[&count]() { ++count; });
+    jobs.Wait(&counter);
+  });
+  t.join();
+  ASSERT_EQ(100,count.load());
+}
+
+TEST(JobSystem,Owner) {
+  JobSystem jobs(1);
+  ASSERT_TRUE(jobs.owns_deque());
+
+  // another system on the same thread doesn't take the deque of jobs away
+  {
+    JobSystem other(1);
+    ASSERT_TRUE(other.owns_deque());
+    ASSERT_TRUE(jobs .owns_deque());
+  }
+  ASSERT_TRUE(jobs.owns_deque());
+
+  bool foreign = true;
+  std::thread t([&jobs,&foreign]() { foreign = jobs.owns_deque(); });
+  t.join();
+  ASSERT_FALSE(foreign);
+
+  // workers own a deque as well
+  std::atomic<int> owned(0);
+  JobCounter counter;
+  for( int i = 0 ; i < 64 ; ++i )
+    jobs.Run(&counter,[&jobs,&owned]() { owned += jobs.owns_deque(); });
+  jobs.Wait(&counter);
+  ASSERT_EQ(64,owned.load());
+}
+
+} // namespace sfe
+
+int main( int argc , char* argv[] ) {
+  testing::InitGoogleTest(&argc,argv);
+  return RUN_ALL_TESTS();
+}
@@ -0,0 +1,349 @@
+#include <include/particle-system.h>
+#include <gtest/gtest.h>
+
+#include <algorithm>
+#include <cmath>
+#include <random>
+#include <vector>
+
+namespace sfe {
+namespace {
+
+typedef detail::ParticleBuffer B;
+
+// Fill every field with random value , some particles are dead and some die
+// in the next update
+void FillRandom( B* buffer , std::size_t count ) {
+  std::mt19937 gen(1234);
+  std::uniform_real_distribution<float> value(-100.0f,100.0f);
+  std::uniform_real_distribution<float> life (0.0f,2.0f);
+
+  for( int f = 0 ; f < B::SIZE_OF_FIELD ; ++f ) {
+    auto field = (*buffer)[static_cast<B::Field>(f)];
+    for( std::size_t i = 0 ; i < count ; ++i ) field[i] = value(gen);
+  }
+  for( std::size_t i = 0 ; i < count ; ++i ) {
+    (*buffer)[B::LIFE][i] = life(gen) + 0.1f;
+    (*buffer)[B::AGE ][i] = life(gen) - 0.2f;
+  }
+}
+
+} // namespace
+
+TEST(ParticleBuffer,Capacity) {
+  B buffer(13);
+  ASSERT_EQ(16u,buffer.capacity());
+  for( int f = 0 ; f < B::SIZE_OF_FIELD ; ++f ) {
+    auto ptr = reinterpret_cast<std::uintptr_t>(buffer[static_cast<B::Field>(f)]);
+    ASSERT_EQ(0u,ptr % B::kAlignment);
+  }
+  for( std::size_t i = 0 ; i < buffer.capacity() ; ++i )
+    ASSERT_LT(buffer[B::AGE][i],0.0f);
+}
+
+TEST(ParticleBuffer,UpdateMatchScalar) {
+  const std::size_t kCount = 1003;
+  B simd(kCount) , scalar(kCount);
+  FillRandom(&simd  ,kCount);
+  FillRandom(&scalar,kCount);
+
+  for( int step = 0 ; step < 10 ; ++step ) {
+    auto d0 = detail::UpdateParticles      (&simd  ,0,kCount,3.0f,-5.0f,0.016f);
+    auto d1 = detail::UpdateParticlesScalar(&scalar,0,kCount,3.0f,-5.0f,0.016f);
+    ASSERT_EQ(d1,d0);
+  }
+
+  for( int f = 0 ; f < B::SIZE_OF_FIELD ; ++f ) {
+    auto a = simd  [static_cast<B::Field>(f)];
+    auto b = scalar[static_cast<B::Field>(f)];
+    for( std::size_t i = 0 ; i < kCount ; ++i )
+      ASSERT_NEAR(b[i],a[i],1e-3f * std::max(1.0f,std::fabs(b[i])));
+  }
+}
+
+TEST(ParticleBuffer,Update) {
+  B buffer(8);
+  buffer[B::AGE       ][0] = 0.0f;
+  buffer[B::LIFE      ][0] = 1.0f;
+  buffer[B::POSITION_X][0] = 10.0f;
+  buffer[B::VELOCITY_X][0] = 1.0f;
+  buffer[B::RADIAL_ACC][0] = 2.0f;
+  buffer[B::GRAVITY   ][0] = 4.0f;
+  buffer[B::SPIN_DELTA][0] = 1.0f;
+
+  ASSERT_EQ(0u,detail::UpdateParticles(&buffer,0,8,0.0f,0.0f,0.5f));
+  ASSERT_FLOAT_EQ(0.5f ,buffer[B::AGE       ][0]);
+  ASSERT_FLOAT_EQ(2.0f ,buffer[B::VELOCITY_X][0]);
+  ASSERT_FLOAT_EQ(2.0f ,buffer[B::VELOCITY_Y][0]);
+  ASSERT_FLOAT_EQ(11.0f,buffer[B::POSITION_X][0]);
+  ASSERT_FLOAT_EQ(1.0f ,buffer[B::POSITION_Y][0]);
+  ASSERT_FLOAT_EQ(0.5f ,buffer[B::SPIN      ][0]);
+
+  // the dead slots are left untouched
+  ASSERT_FLOAT_EQ(0.0f,buffer[B::POSITION_X][1]);
+  ASSERT_LT(buffer[B::AGE][1],0.0f);
+
+  ASSERT_EQ(1u,detail::UpdateParticles(&buffer,0,8,0.0f,0.0f,0.5f));
+  ASSERT_LT(buffer[B::AGE][0],0.0f);
+  ASSERT_FLOAT_EQ(11.0f,buffer[B::POSITION_X][0]);
+}
+
+TEST(ParticleBuffer,Kernel) {
+  const std::size_t kCount = 203;
+  const B::Field kTerm[] = { B::GRAVITY , B::RADIAL_ACC , B::TANGENTIAL_ACC ,
+                             B::SPIN_DELTA };
+
+  for( unsigned feature = 0 ; feature < detail::SIZE_OF_FEATURE_SET ; ++feature ) {
+    B generic(kCount) , special(kCount);
+    FillRandom(&generic,kCount);
+    FillRandom(&special,kCount);
+    for( std::size_t k = 0 ; k < 4 ; ++k ) {
+      if(feature & (1u << k)) continue;
+      std::fill(generic[kTerm[k]],generic[kTerm[k]] + kCount,0.0f);
+      std::fill(special[kTerm[k]],special[kTerm[k]] + kCount,0.0f);
+    }
+
+    auto kernel = detail::GetParticleKernel(feature);
+    for( int step = 0 ; step < 5 ; ++step ) {
+      auto d0 = detail::UpdateParticles(&generic,0,kCount,3.0f,-5.0f,0.016f);
+      auto d1 = kernel                 (&special,0,kCount,3.0f,-5.0f,0.016f);
+      ASSERT_EQ(d0,d1);
+    }
+
+    for( int f = 0 ; f < B::SIZE_OF_FIELD ; ++f ) {
+      auto a = generic[static_cast<B::Field>(f)];
+      auto b = special[static_cast<B::Field>(f)];
+      for( std::size_t i = 0 ; i < kCount ; ++i ) ASSERT_FLOAT_EQ(a[i],b[i]);
+    }
+  }
+}
+
+TEST(ParticleBuffer,Compact) {
+  B buffer(10);
+  auto first = buffer.Allocate(10);
+  ASSERT_EQ(0u,first);
+  for( std::size_t i = 0 ; i < 10 ; ++i ) {
+    buffer[B::AGE       ][i] = 0.0f;
+    buffer[B::POSITION_X][i] = static_cast<float>(i);
+  }
+  buffer[B::AGE][2] = buffer[B::AGE][5] = buffer[B::AGE][9] = -1.0f;
+
+  buffer.Compact();
+  ASSERT_EQ(7u,buffer.size());
+
+  const float expect[] = { 0 , 1 , 8 , 3 , 4 , 7 , 6 };
+  for( std::size_t i = 0 ; i < 7 ; ++i ) {
+    ASSERT_FLOAT_EQ(expect[i],buffer[B::POSITION_X][i]);
+    ASSERT_GE(buffer[B::AGE][i],0.0f);
+  }
+  for( std::size_t i = 7 ; i < buffer.capacity() ; ++i )
+    ASSERT_LT(buffer[B::AGE][i],0.0f);
+
+  buffer.Clear();
+  ASSERT_EQ(0u,buffer.size());
+  ASSERT_LT(buffer[B::AGE][0],0.0f);
+}
+
+TEST(ParticleLut,Sample) {
+  ColorGradient color;
+  color.push_back(GradientStop<Color>(0.75f,Color(0  ,0  ,0  ,255)));
+  color.push_back(GradientStop<Color>(0.25f,Color(255,255,0  ,0  )));
+  FloatGradient size;
+  size.push_back(GradientStop<float>(0.0f,1.0f));
+  size.push_back(GradientStop<float>(1.0f,3.0f));
+
+  const std::size_t N = detail::ParticleLut::kSize;
+  detail::ParticleLut lut(color,size);
+  // Color is a,r,g,b and sf::Color is r,g,b,a
+  ASSERT_EQ(sf::Color(255,0,0,255),lut.color[0]);
+  ASSERT_EQ(sf::Color(0,0,255,0) ,lut.color[N - 1]);
+  ASSERT_FLOAT_EQ(1.0f,lut.size[0]);
+  ASSERT_FLOAT_EQ(3.0f,lut.size[N - 1]);
+
+  // linear between the stops
+  for( std::size_t i = 0 ; i < N ; ++i ) {
+    auto t = static_cast<float>(i) / (N - 1);
+    ASSERT_NEAR(1.0f + 2.0f * t,lut.size[i],1e-5f);
+    ASSERT_NEAR(255,lut.color[i].r + lut.color[i].b,1);
+    if(t <= 0.25f) { ASSERT_EQ(255,lut.color[i].r); }
+    if(t >= 0.75f) { ASSERT_EQ(0  ,lut.color[i].r); }
+  }
+
+  // white and 1 without gradient
+  detail::ParticleLut plain((ColorGradient()),FloatGradient());
+  for( std::size_t i = 0 ; i < N ; ++i ) {
+    ASSERT_EQ(sf::Color::White,plain.color[i]);
+    ASSERT_FLOAT_EQ(1.0f,plain.size[i]);
+  }
+}
+
+TEST(ParticleBuffer,EmitQuads) {
+  const std::size_t kCount = 37;
+  B buffer(kCount);
+  FillRandom(&buffer,kCount);
+  for( std::size_t i = 0 ; i < kCount ; ++i ) {
+    buffer[B::SPIN][i] *= 0.5f;
+    buffer[B::SIZE][i]  = std::fabs(buffer[B::SIZE][i]) * 0.05f;
+  }
+
+  ColorGradient color;
+  color.push_back(GradientStop<Color>(0.0f,Color(255,255,0,0)));
+  color.push_back(GradientStop<Color>(0.5f,Color(128,0,255,0)));
+  color.push_back(GradientStop<Color>(1.0f,Color(0  ,0,0,255)));
+  FloatGradient size;
+  size.push_back(GradientStop<float>(0.0f,0.5f));
+  size.push_back(GradientStop<float>(1.0f,2.0f));
+  detail::ParticleLut lut(color,size);
+
+  sf::IntRect rect(16,32,8,4);
+  std::vector<sf::Vertex> output(kCount * 4);
+  detail::EmitParticleQuads(&buffer,0,kCount,detail::ParticleShape(rect),lut,
+                            output.data());
+
+  // the same particle rendered through a Quad
+  RenderBatch batch(sf::BlendAlpha);
+  Quad quad(&batch,rect);
+  quad.SetAnchor(4.0f,2.0f);
+  for( std::size_t i = 0 ; i < kCount ; ++i ) {
+    // the lut sample closest to the normalized age
+    auto t     = buffer[B::AGE][i] * (1.0f / buffer[B::LIFE][i]);
+    auto index = static_cast<std::size_t>(
+        std::min(1.0f,std::max(0.0f,t)) * (detail::ParticleLut::kSize - 1.0f) +
+        0.5f);
+    auto scale = buffer[B::SIZE][i] * lut.size[index];
+
+    quad.SetPosition(buffer[B::POSITION_X][i],buffer[B::POSITION_Y][i]);
+    quad.SetRotation(buffer[B::SPIN][i] * 180.0f / 3.14159265358979f);
+    quad.SetScale   (scale,scale);
+    quad.SetColor   (lut.color[index]);
+
+    auto expect = quad.GetWorldVertex();
+    for( std::size_t k = 0 ; k < 4 ; ++k ) {
+      auto& v = output[i * 4 + k];
+      ASSERT_NEAR(expect[k].position.x,v.position.x,1e-3f);
+      ASSERT_NEAR(expect[k].position.y,v.position.y,1e-3f);
+      ASSERT_EQ(expect[k].texCoords.x,v.texCoords.x);
+      ASSERT_EQ(expect[k].texCoords.y,v.texCoords.y);
+      ASSERT_EQ(expect[k].color,v.color);
+    }
+  }
+}
+
+TEST(ParticleSystem,Emit) {
+  ParticleConfig config;
+  config.max_particles = 50;
+  config.rate          = 100.0f;
+  config.life          = FloatRange(1.0f,1.0f);
+
+  RenderBatch batch(sf::BlendAlpha);
+  batch.set_quad_list(true);
+  ParticleSystem system(config,&batch,sf::IntRect(0,0,4,4));
+  ASSERT_TRUE(system.dead());
+
+  system.Fire();
+  system.Update(0.1f);
+  ASSERT_EQ(10u,system.alive_count());
+
+  system.Render();
+  ASSERT_EQ(40u,batch.vertex_count());
+
+  // bounded by max_particles
+  system.Update(0.5f);
+  ASSERT_EQ(50u,system.alive_count());
+
+  // all the particles die after their life
+  system.Stop();
+  system.Update(1.0f);
+  ASSERT_EQ(0u,system.alive_count());
+  ASSERT_TRUE(system.dead());
+}
+
+TEST(ParticleSystem,Feature) {
+  RenderBatch batch(sf::BlendAlpha);
+  ParticleConfig config;
+  {
+    ParticleSystem system(config,&batch,sf::IntRect(0,0,4,4));
+    ASSERT_EQ(0u,system.feature());
+  }
+
+  config.gravity    = FloatRange(9.8f,9.8f);
+  config.spin_delta = FloatRange(-1.0f,0.0f);
+  {
+    ParticleSystem system(config,&batch,sf::IntRect(0,0,4,4));
+    ASSERT_EQ(unsigned(detail::FEATURE_GRAVITY | detail::FEATURE_SPIN),
+              system.feature());
+  }
+
+  config.radial_acc     = FloatRange(0.0f,1.0f);
+  config.tangential_acc = FloatRange(-2.0f,-1.0f);
+  {
+    ParticleSystem system(config,&batch,sf::IntRect(0,0,4,4));
+    ASSERT_EQ(unsigned(detail::FEATURE_ALL),system.feature());
+  }
+}
+
+TEST(ParticleSystem,Seed) {
+  ParticleConfig config;
+  config.life  = FloatRange(0.5f,1.5f);
+  config.speed = FloatRange(10.0f,50.0f);
+  config.seed  = 99;
+
+  RenderBatch batch(sf::BlendAlpha);
+  ParticleSystem a(config,&batch,sf::IntRect(0,0,4,4));
+  ParticleSystem b(config,&batch,sf::IntRect(0,0,4,4));
+  a.Fire();
+  b.Fire();
+  for( int i = 0 ; i < 60 ; ++i ) {
+    a.Update(1.0f / 30.0f);
+    b.Update(1.0f / 30.0f);
+  }
+
+  ASSERT_EQ(a.alive_count(),b.alive_count());
+  for( int f = 0 ; f < B::SIZE_OF_FIELD ; ++f ) {
+    auto x = a.buffer()[static_cast<B::Field>(f)];
+    auto y = b.buffer()[static_cast<B::Field>(f)];
+    for( std::size_t i = 0 ; i < a.alive_count() ; ++i ) ASSERT_EQ(x[i],y[i]);
+  }
+}
+
+TEST(ParticleSystem,Parallel) {
+  ParticleConfig config;
+  config.max_particles = 20000;
+  config.rate          = 100000.0f;
+  config.life          = FloatRange(0.5f,1.5f);
+  config.speed         = FloatRange(10.0f,50.0f);
+  config.spin_delta    = FloatRange(-1.0f,1.0f);
+  config.size          = FloatRange(0.5f,2.0f);
+  config.color_over_life.push_back(GradientStop<Color>(0.0f,Color(255,255,0,0)));
+  config.color_over_life.push_back(GradientStop<Color>(1.0f,Color(0,0,0,255)));
+
+  RenderBatch batch(sf::BlendAlpha);
+  batch.set_quad_list(true);
+  ParticleSystem system(config,&batch,sf::IntRect(0,0,4,4));
+  system.set_parallel_threshold(1);
+  system.Fire();
+  for( int i = 0 ; i < 60 ; ++i ) system.Update(1.0f / 30.0f);
+
+  auto count = system.alive_count();
+  ASSERT_GT(count,ParticleSystem::kParallelChunk);
+
+  // the chunked render writes the same vertex as the serial one
+  system.Render();
+  system.set_parallel_threshold(static_cast<std::size_t>(-1));
+  system.Render();
+  ASSERT_EQ(count * 8,batch.vertex_count());
+
+  auto v = batch.vertex();
+  for( std::size_t i = 0 ; i < count * 4 ; ++i ) {
+    ASSERT_FLOAT_EQ(v[i].position.x,v[i + count * 4].position.x);
+    ASSERT_FLOAT_EQ(v[i].position.y,v[i + count * 4].position.y);
+    ASSERT_EQ(v[i].color,v[i + count * 4].color);
+  }
+}
+
+} // namespace sfe
+
+int main( int argc , char* argv[] ) {
+  ::testing::InitGoogleTest(&argc,argv);
+  return RUN_ALL_TESTS();
+}
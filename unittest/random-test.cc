@@ -0,0 +1,110 @@
+#include <include/random.h>
+#include <include/adt.h>
+#include <gtest/gtest.h>
+
+#include <cmath>
+#include <vector>
+
+namespace sfe {
+
+TEST(Random,Seed) {
+  Random a(42) , b(42) , c(43);
+  bool differ = false;
+  for( int i = 0 ; i < 100 ; ++i ) {
+    auto v = a.Next();
+    ASSERT_EQ(v,b.Next());
+    differ = differ || v != c.Next();
+  }
+  ASSERT_TRUE(differ);
+
+  // restart from the seed
+  Random d(7);
+  auto first = d.Next();
+  d.Next();
+  d.Seed(7);
+  ASSERT_EQ(first,d.Next());
+}
+
+TEST(Random,Get) {
+  Random rng(1);
+  bool lower = false , upper = false;
+  for( int i = 0 ; i < 10000 ; ++i ) {
+    auto v = rng.Get(-3,3);
+    ASSERT_GE(v,-3);
+    ASSERT_LE(v,3);
+    lower = lower || v == -3;
+    upper = upper || v == 3;
+
+    auto f = rng.Get(2.0f,5.0f);
+    ASSERT_GE(f,2.0f);
+    ASSERT_LT(f,5.0f);
+  }
+  ASSERT_TRUE(lower && upper);
+}
+
+TEST(Random,Fill) {
+  const std::size_t kCount = 10003;
+  Random a(9) , b(9);
+
+  std::vector<float> x(kCount) , y(kCount);
+  a.Fill(x.data(),kCount,-1.0f,1.0f);
+  b.Fill(y.data(),kCount,-1.0f,1.0f);
+
+  double sum = 0.0;
+  for( std::size_t i = 0 ; i < kCount ; ++i ) {
+    ASSERT_EQ(x[i],y[i]);
+    ASSERT_GE(x[i],-1.0f);
+    ASSERT_LT(x[i], 1.0f);
+    sum += x[i];
+  }
+  ASSERT_NEAR(0.0,sum / kCount,0.05);
+
+  std::vector<std::int32_t> n(kCount);
+  a.Fill(n.data(),kCount,10,13);
+  int hit[4] = { 0 };
+  for( auto e : n ) {
+    ASSERT_GE(e,10);
+    ASSERT_LE(e,13);
+    ++hit[e - 10];
+  }
+  for( auto e : hit ) ASSERT_GT(e,2000);
+}
+
+TEST(Random,Upper) {
+  // half of l + (u-l)*x rounds up to u in a 1 ulp range
+  const float l = 1.0f , u = std::nextafter(1.0f,2.0f);
+  Random rng(5);
+  std::vector<float> v(1001);
+  rng.Fill(v.data(),v.size(),l,u);
+  for( auto e : v ) ASSERT_EQ(l,e);
+  for( int i = 0 ; i < 1000 ; ++i ) ASSERT_EQ(l,rng.Get(l,u));
+
+  const double dl = 1.0 , du = std::nextafter(1.0,2.0);
+  for( int i = 0 ; i < 1000 ; ++i ) ASSERT_EQ(dl,rng.Get(dl,du));
+}
+
+TEST(Random,FillRandom) {
+  Random rng(3);
+  FloatRange range(5.0f,6.0f);
+  float v[13];
+  range.FillRandom(v,13,&rng);
+  for( auto e : v ) {
+    ASSERT_GE(e,5.0f);
+    ASSERT_LT(e,6.0f);
+  }
+
+  DoubleRange d(1.0,2.0);
+  double w[5];
+  d.FillRandom(w,5,&rng);
+  for( auto e : w ) {
+    ASSERT_GE(e,1.0);
+    ASSERT_LT(e,2.0);
+  }
+}
+
+} // namespace sfe
+
+int main( int argc , char* argv[] ) {
+  ::testing::InitGoogleTest(&argc,argv);
+  return RUN_ALL_TESTS();
+}
@@ -1,75 +1,183 @@
-#include "app.h"
-#include "render-batch.h"
+#include <include/render-batch.h>
+#include <include/render-queue.h>
+#include <gtest/gtest.h>
 
-#include <iostream>
+#include <memory>
+#include <vector>
+
+// Headless , everything renders into a sf::RenderTexture
 
 namespace sfe {
 
-class TestApp : public App {
- public:
-  TestApp(): App( "test" , 30, 800, 600 ) , texture_ () , batch_ () , sprites_ () {}
-  virtual bool HandleInit() {
-    texture_.reset( new sf::Texture() );
-    if(!texture_->loadFromFile("my_image.png")) {
-      std::cerr<<"failed to load my_image.png"<<std::endl;
-      return false;
-    }
+namespace {
+
+const unsigned kSize = 64;
+
+bool CreateTarget( sf::RenderTexture* target ) {
+  if(!target->create(kSize,kSize)) return false;
+  target->clear(sf::Color::Black);
+  return true;
+}
 
-    batch_.reset(new RenderBatch(
-          sf::BlendMode(sf::BlendMode::SrcColor,sf::BlendMode::DstColor)));
+} // namespace
+
+TEST(RenderBatch,QuadVertex) {
+  RenderBatch batch;
+  batch.set_quad_list(true);
+
+  Quad q(&batch,sf::IntRect(0,0,10,20));
+  q.SetPosition(5,7);
+  q.Render();
+  ASSERT_EQ(4u,batch.vertex_count());
+
+  auto bounds = q.GetWorldBounds();
+  ASSERT_FLOAT_EQ(5.0f ,bounds.left);
+  ASSERT_FLOAT_EQ(7.0f ,bounds.top);
+  ASSERT_FLOAT_EQ(10.0f,bounds.width);
+  ASSERT_FLOAT_EQ(20.0f,bounds.height);
+
+  // the bulk path must generate the same vertex as the per quad path
+  RenderBatch bulk;
+  bulk.set_quad_list(true);
+  const Quad* list[] = { &q };
+  bulk.EnqueueQuads(list,1);
+  ASSERT_EQ(4u,bulk.vertex_count());
+  for( std::size_t i = 0 ; i < 4 ; ++i ) {
+    ASSERT_FLOAT_EQ(batch.vertex()[i].position.x,bulk.vertex()[i].position.x);
+    ASSERT_FLOAT_EQ(batch.vertex()[i].position.y,bulk.vertex()[i].position.y);
+  }
 
-#if 0
-    r_.resize(10000);
-    for( auto &e : r_ ) {
-      e.reset( new sf::RectangleShape(sf::Vector2f(128,128)) );
-      e->setFillColor(sf::Color(255,123,2,255));
+  batch.Clear();
+  ASSERT_EQ(0u,batch.vertex_count());
+}
+
+TEST(RenderBatch,DirtyQuads) {
+  RenderBatch batch , bulk;
+  batch.set_quad_list(true);
+  bulk .set_quad_list(true);
+
+  // 2 identical sets of quads , one goes through the per quad path and the
+  // other one through the bulk path
+  std::vector<std::unique_ptr<Quad>> quads[2];
+  std::vector<const Quad*> list;
+  for( int i = 0 ; i < 7 ; ++i ) {
+    for( auto& q : quads ) {
+      q.emplace_back(new Quad(&batch,sf::IntRect(0,0,8,4)));
+      q.back()->SetPosition(static_cast<float>(i * 10),static_cast<float>(i));
+      q.back()->SetRotation(static_cast<float>(i * 15));
     }
-#endif
+    list.push_back(quads[1].back().get());
+  }
 
-    sprites_.resize(20);
-    for( auto &e : sprites_ ) {
-      e.reset( new Quad(batch_.get(),sf::IntRect(0,0,128,128)) );
-      e->SetColor(sf::Color(255,123,2,255));
+  // all dirty , then an odd number of dirty quads between clean ones
+  for( int round = 0 ; round < 2 ; ++round ) {
+    if(round == 1) {
+      for( int i : { 1 , 2 , 5 } ) {
+        for( auto& q : quads ) q[i]->SetScale(2.0f,0.5f);
+      }
     }
-    set_clear_color(sf::Color::White);
-    return true;
+
+    for( auto& q : quads[0] ) q->Render();
+    bulk.EnqueueQuads(list.data(),list.size());
+    ASSERT_EQ(batch.vertex_count(),bulk.vertex_count());
+    for( std::size_t i = 0 ; i < batch.vertex_count() ; ++i ) {
+      ASSERT_FLOAT_EQ(batch.vertex()[i].position.x,bulk.vertex()[i].position.x);
+      ASSERT_FLOAT_EQ(batch.vertex()[i].position.y,bulk.vertex()[i].position.y);
+    }
+    batch.Clear();
+    bulk .Clear();
   }
+}
+
+TEST(RenderBatch,Render) {
+  sf::RenderTexture target;
+  ASSERT_TRUE(CreateTarget(&target));
 
-  virtual void HandleUpdate( float delta , sf::RenderWindow* window ) {
-    std::cout<<"TIME:"<<1.0f/delta<<"\n";
-#if 0
-    for( auto &e : r_ ) {
-      e->setPosition(500,400);
-      window->draw(*e);
+  for( auto backend : { RenderBatch::CLIENT_ARRAY ,
+                        RenderBatch::STREAM_BUFFER } ) {
+    RenderBatch batch(sf::BlendAlpha,NULL,NULL,sf::TriangleStrip,backend);
+    batch.set_quad_list(true);
+
+    std::vector<std::unique_ptr<Quad>> quads;
+    for( int i = 0 ; i < 4 ; ++i ) {
+      quads.emplace_back(new Quad(&batch,sf::IntRect(0,0,8,8)));
+      quads.back()->SetPosition(static_cast<float>(i * 16),0);
+      quads.back()->SetColor(sf::Color::Red);
+      quads.back()->Render();
     }
-#endif
-
-    for( std::size_t i = 0 ; i  < 100 ; ++i ) {
-      {
-        for( auto &e : sprites_ ) {
-          e->SetPosition(500,400);
-          e->Render();
-        }
-      }
 
-      {
-        batch_->Render(window);
-      }
+    target.clear(sf::Color::Black);
+    batch.Render(&target);
+    target.display();
+    ASSERT_EQ(0u,batch.vertex_count());
+
+    auto image = target.getTexture().copyToImage();
+    for( int i = 0 ; i < 4 ; ++i ) {
+      ASSERT_EQ(sf::Color::Red  ,image.getPixel(i * 16 + 4,4));
+      ASSERT_EQ(sf::Color::Black,image.getPixel(i * 16 + 12,4));
     }
+    ASSERT_EQ(sf::Color::Black,image.getPixel(4,20));
+  }
+}
+
+TEST(RenderBatch,View) {
+  sf::RenderTexture target;
+  ASSERT_TRUE(CreateTarget(&target));
+
+  RenderBatch batch(sf::BlendAlpha);
+  batch.set_quad_list(true);
+
+  // the raw GL draw uses the view set right before it , the world is
+  // shifted by 32 pixels to the left
+  target.setView(sf::View(sf::FloatRect(32,0,kSize,kSize)));
+
+  Quad quad(&batch,sf::IntRect(0,0,8,8));
+  quad.SetPosition(32,0);
+  quad.SetColor(sf::Color::Red);
+  quad.Render();
+  batch.Render(&target);
+  target.display();
+
+  auto image = target.getTexture().copyToImage();
+  ASSERT_EQ(sf::Color::Red  ,image.getPixel(4 ,4));
+  ASSERT_EQ(sf::Color::Black,image.getPixel(36,4));
+  ASSERT_EQ(sf::Color::Black,image.getPixel(4 ,20));
+}
+
+TEST(RenderQueue,Flush) {
+  sf::RenderTexture target;
+  ASSERT_TRUE(CreateTarget(&target));
+
+  RenderBatch alpha(sf::BlendAlpha);
+  RenderBatch add  (sf::BlendAdd);
+  alpha.set_quad_list(true);
+  add.set_quad_list(true);
+
+  std::vector<std::unique_ptr<Quad>> quads;
+  for( int i = 0 ; i < 8 ; ++i ) {
+    quads.emplace_back(new Quad(i % 2 ? &add : &alpha,sf::IntRect(0,0,4,4)));
+    quads.back()->SetPosition(static_cast<float>(i * 8),0);
+    quads.back()->SetColor(sf::Color::Green);
   }
 
-  virtual void HandleClose() {}
- private:
-  std::unique_ptr<sf::Texture> texture_;
-  std::unique_ptr<RenderBatch> batch_;
-  std::vector<std::unique_ptr<Quad>> sprites_;
-  std::vector<std::unique_ptr<sf::RectangleShape>> r_;
-};
+  RenderQueue queue;
+  for( auto& e : quads ) queue.Submit(*e,static_cast<std::uint8_t>(0));
+  queue.Flush(&target);
+  target.display();
+
+  // interleaved submission is sorted into one draw per blend mode
+  ASSERT_EQ(8u ,queue.stats().submission);
+  ASSERT_EQ(2u ,queue.stats().draw_call);
+  ASSERT_EQ(32u,queue.stats().vertex);
+
+  auto image = target.getTexture().copyToImage();
+  for( int i = 0 ; i < 8 ; ++i )
+    ASSERT_EQ(sf::Color::Green,image.getPixel(i * 8 + 2,2));
+}
 
 } // namespace sfe
 
-int main() {
-  sfe::TestApp app;
-  app.Start();
-  return 0;
+int main( int argc , char* argv[] ) {
+  testing::InitGoogleTest(&argc,argv);
+  return RUN_ALL_TESTS();
 }
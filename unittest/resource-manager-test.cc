@@ -0,0 +1,61 @@
+#include <include/resource-manager.h>
+#include <gtest/gtest.h>
+
+#include <filesystem>
+
+namespace sfe {
+
+namespace {
+
+namespace fs = std::filesystem;
+
+// A level with 2 small images and 1 too large for an atlas page
+fs::path CreateLevel() {
+  auto root = fs::temp_directory_path() / "sfe-resource-manager-test";
+  fs::remove_all(root);
+  fs::create_directories(root / "level");
+
+  sf::Image image;
+  image.create(16,16,sf::Color::Red);
+  image.saveToFile((root / "level" / "a.png").string());
+  image.create(8,32,sf::Color::Green);
+  image.saveToFile((root / "level" / "b.png").string());
+  image.create(ResourceManager::kAtlasPageSize + 1,4,sf::Color::Blue);
+  image.saveToFile((root / "level" / "large.png").string());
+  return root;
+}
+
+} // namespace
+
+TEST(ResourceManager,AtlasCache) {
+  auto root = CreateLevel();
+
+  // the second load comes from the cache written by the first one
+  for( int i = 0 ; i < 2 ; ++i ) {
+    ResourceManager manager(root.string());
+    ASSERT_TRUE(manager.LoadLevel("level",true));
+    ASSERT_TRUE(fs::exists(root / "level" / ".atlas" / "manifest.txt"));
+    ASSERT_EQ(1u,manager.atlas_page_size());
+
+    TextureRegion a , b , large;
+    ASSERT_TRUE(manager.GetTextureRegion("a",&a));
+    ASSERT_TRUE(manager.GetTextureRegion("b",&b));
+    ASSERT_EQ(a.texture,b.texture);
+    ASSERT_EQ(16,a.rect.width);
+    ASSERT_EQ(32,b.rect.height);
+
+    // the large image is a standalone texture
+    ASSERT_TRUE(manager.GetTexture("large") != NULL);
+    ASSERT_TRUE(manager.GetTextureRegion("large",&large));
+    ASSERT_NE(a.texture,large.texture);
+    ASSERT_EQ(ResourceManager::kAtlasPageSize + 1,large.rect.width);
+  }
+  fs::remove_all(root);
+}
+
+} // namespace sfe
+
+int main( int argc , char* argv[] ) {
+  ::testing::InitGoogleTest(&argc,argv);
+  return RUN_ALL_TESTS();
+}
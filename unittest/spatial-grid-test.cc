@@ -0,0 +1,126 @@
+#include <include/spatial-grid.h>
+#include <gtest/gtest.h>
+
+#include <algorithm>
+
+namespace sfe {
+
+namespace {
+
+bool Contains( const std::vector<const Quad*>& list , const Quad* q ) {
+  return std::find(list.begin(),list.end(),q) != list.end();
+}
+
+} // namespace
+
+TEST(SpatialGrid,Query) {
+  RenderBatch batch;
+  SpatialGrid grid(64.0f);
+
+  Quad q1(&batch,sf::IntRect(0,0,10,10));
+  Quad q2(&batch,sf::IntRect(0,0,200,200));   // spans several cells
+  q1.SetPosition(100,100);
+  q2.SetPosition(-100,-100);
+
+  grid.Insert(&q1);
+  auto h2 = grid.Insert(&q2);
+  ASSERT_EQ(2u,grid.size());
+
+  {
+    std::vector<const Quad*> output;
+    grid.Query(sf::FloatRect(0,0,800,600),&output);
+    ASSERT_EQ(2u,output.size());
+    ASSERT_TRUE(Contains(output,&q1));
+    ASSERT_TRUE(Contains(output,&q2));
+  }
+
+  {
+    std::vector<const Quad*> output;
+    grid.Query(sf::FloatRect(500,500,100,100),&output);
+    ASSERT_TRUE(output.empty());
+  }
+
+  // move q1 far away , the grid picks it up on Refresh
+  q1.SetPosition(10000,10000);
+  grid.Refresh();
+
+  {
+    std::vector<const Quad*> output;
+    grid.Query(sf::FloatRect(0,0,800,600),&output);
+    ASSERT_EQ(1u,output.size());
+    ASSERT_TRUE(Contains(output,&q2));
+
+    output.clear();
+    grid.Query(sf::FloatRect(9990,9990,100,100),&output);
+    ASSERT_EQ(1u,output.size());
+    ASSERT_TRUE(Contains(output,&q1));
+  }
+
+  grid.Remove(h2);
+  ASSERT_EQ(1u,grid.size());
+
+  {
+    std::vector<const Quad*> output;
+    grid.Query(sf::FloatRect(-1000,-1000,2000,2000),&output);
+    ASSERT_TRUE(output.empty());
+  }
+}
+
+TEST(SpatialGrid,Render) {
+  RenderBatch batch;
+  batch.set_quad_list(true);
+  SpatialGrid grid(128.0f);
+
+  std::vector<std::unique_ptr<Quad>> quads;
+  for( int i = 0 ; i < 100 ; ++i ) {
+    quads.emplace_back(new Quad(&batch,sf::IntRect(0,0,16,16)));
+    quads.back()->SetPosition(static_cast<float>(i * 100),0);
+    grid.Insert(quads.back().get());
+  }
+
+  // view covers x in [0,800)
+  sf::View view(sf::FloatRect(0,-300,800,600));
+  auto visible = grid.Render(view);
+  ASSERT_EQ(8u,visible);
+  ASSERT_EQ(8u * 4,batch.vertex_count());
+}
+
+TEST(SpatialGrid,Order) {
+  RenderBatch batch;
+  batch.set_quad_list(true);
+  SpatialGrid grid(32.0f);
+
+  // overlapping quads spread over many cells , each one marked by its
+  // position
+  std::vector<std::unique_ptr<Quad>> quads;
+  std::vector<SpatialGrid::Handle>   handle;
+  for( int i = 0 ; i < 64 ; ++i ) {
+    quads.emplace_back(new Quad(&batch,sf::IntRect(0,0,100,100)));
+    quads.back()->SetPosition(static_cast<float>((i * 37) % 200),
+                              static_cast<float>((i * 53) % 200));
+    handle.push_back(grid.Insert(quads.back().get()));
+  }
+
+  // a removed handle is reused by the next insert , the new quad still
+  // goes after all the existing ones
+  grid.Remove(handle[10]);
+  quads.emplace_back(new Quad(&batch,sf::IntRect(0,0,100,100)));
+  quads.back()->SetPosition(-50,-50);
+  grid.Insert(quads.back().get());
+  quads.erase(quads.begin() + 10);
+
+  sf::View view(sf::FloatRect(0,0,400,400));
+  ASSERT_EQ(quads.size(),grid.Render(view));
+  ASSERT_EQ(quads.size() * 4,batch.vertex_count());
+  for( std::size_t i = 0 ; i < quads.size() ; ++i ) {
+    ASSERT_EQ(quads[i]->GetWorldVertex()[0].position,
+              batch.vertex()[i * 4].position);
+  }
+}
+
+} // namespace sfe
+
+int main( int argc, char* argv[] ) {
+  testing::InitGoogleTest(&argc,argv);
+  return RUN_ALL_TESTS();
+}
@@ -0,0 +1,69 @@
+#include <include/sprite-instance-batch.h>
+#include <gtest/gtest.h>
+
+// Headless , everything renders into a sf::RenderTexture
+
+namespace sfe {
+
+namespace {
+
+const unsigned kSize = 64;
+
+// Draw the sprite right after switching to view
+sf::Image Draw( const SpriteInstance& sprite , const sf::View& view ,
+                                               bool fallback ) {
+  sf::RenderTexture target;
+  EXPECT_TRUE(target.create(kSize,kSize));
+  target.clear(sf::Color::Black);
+  target.setView(view);
+
+  SpriteInstanceBatch batch(sf::BlendAlpha);
+  batch.set_force_fallback(fallback);
+  batch.Enqueue(sprite);
+  batch.Render(&target);
+  EXPECT_EQ(0u,batch.instance_count());
+  target.display();
+  return target.getTexture().copyToImage();
+}
+
+} // namespace
+
+TEST(SpriteInstanceBatch,View) {
+  // the instanced path when the context supports it , and the fallback
+  // a red 8x8 sprite at world (32,0) with a view shifted by 32 pixels ,
+  // it lands at the top left corner of the target
+  auto sprite = SpriteInstance::Make(32.0f,0.0f,0.0f,1.0f,1.0f,0.0f,0.0f,
+                                     sf::IntRect(0,0,8,8),sf::Color::Red);
+  for( bool fallback : { false , true } ) {
+    auto image = Draw(sprite,sf::View(sf::FloatRect(32,0,kSize,kSize)),fallback);
+    ASSERT_EQ(sf::Color::Red  ,image.getPixel(4 ,4));
+    ASSERT_EQ(sf::Color::Black,image.getPixel(36,4));
+    ASSERT_EQ(sf::Color::Black,image.getPixel(4 ,20));
+  }
+}
+
+TEST(SpriteInstanceBatch,Anchor) {
+  auto sprite = SpriteInstance::Make(0,0,0,1,1,4.5f,-0.25f,sf::IntRect(),
+                                     sf::Color::Red);
+  ASSERT_EQ(72,sprite.anchor_x);
+  ASSERT_EQ(-4,sprite.anchor_y);
+
+  // a 2x2 rect scaled by 4 with a half pixel anchor covers [14,22) , a
+  // whole pixel anchor would cover [12,20)
+  sprite = SpriteInstance::Make(16.0f,0.0f,0.0f,4.0f,4.0f,0.5f,0.0f,
+                                sf::IntRect(0,0,2,2),sf::Color::Red);
+  for( bool fallback : { false , true } ) {
+    auto image = Draw(sprite,sf::View(sf::FloatRect(0,0,kSize,kSize)),fallback);
+    ASSERT_EQ(sf::Color::Black,image.getPixel(13,4));
+    ASSERT_EQ(sf::Color::Red  ,image.getPixel(14,4));
+    ASSERT_EQ(sf::Color::Red  ,image.getPixel(21,4));
+    ASSERT_EQ(sf::Color::Black,image.getPixel(22,4));
+  }
+}
+
+} // namespace sfe
+
+int main( int argc , char* argv[] ) {
+  ::testing::InitGoogleTest(&argc,argv);
+  return RUN_ALL_TESTS();
+}
@@ -19,6 +19,36 @@ TEST(Util,ParseBlendMode) {
   }
 }
 
+TEST(Util,ParseGradient) {
+  {
+    ColorGradient output;
+    ASSERT_TRUE(ParseGradient("0:255,128,0,255; 0.5:1,2,3,4;1:0,0,0,0",&output));
+    ASSERT_EQ(3u,output.size());
+    ASSERT_FLOAT_EQ(0.5f,output[1].time);
+    ASSERT_EQ(255,output[0].value.r);
+    ASSERT_EQ(128,output[0].value.g);
+    ASSERT_EQ(0  ,output[0].value.b);
+    ASSERT_EQ(255,output[0].value.a);
+    ASSERT_EQ(4  ,output[1].value.a);
+    ASSERT_FLOAT_EQ(1.0f,output[2].time);
+
+    ASSERT_FALSE(ParseGradient("",&output));
+    ASSERT_FALSE(ParseGradient("0:255,0,0",&output));
+    ASSERT_FALSE(ParseGradient("0:256,0,0,0",&output));
+    ASSERT_FALSE(ParseGradient("1.5:0,0,0,0",&output));
+    ASSERT_FALSE(ParseGradient("0:0,0,0,0 1:0,0,0,0",&output));
+    ASSERT_EQ(3u,output.size());
+  }
+  {
+    FloatGradient output;
+    ASSERT_TRUE(ParseGradient("0:0.5;1:2;",&output));
+    ASSERT_EQ(2u,output.size());
+    ASSERT_FLOAT_EQ(0.5f,output[0].value);
+    ASSERT_FLOAT_EQ(2.0f,output[1].value);
+    ASSERT_FALSE(ParseGradient("0:-1",&output));
+  }
+}
+
 } // namespace util
 } // namespace sfe
 